@@ -5,6 +5,11 @@
 
 #include "systick.h"
 
+/* DWT周期计数器寄存器 (CMSIS core_cm3.h未定义DWT结构) */
+#define DWT_CTRL    (*(volatile uint32_t *)0xE0001000)
+#define DWT_CYCCNT  (*(volatile uint32_t *)0xE0001004)
+#define DWT_CTRL_CYCCNTENA  0x00000001
+
 /* 全局变量 */
 static volatile uint32_t SystemTick_ms = 0;  // 系统运行时间(毫秒)
 static volatile uint32_t DelayTick_ms = 0;   // 延时计数器
@@ -77,13 +82,30 @@ uint32_t GetSysTime_ms(void)
 
 /**
  * @brief  获取系统运行时间(微秒)
- * @note   精度约为1ms，但返回微秒值
+ * @note   毫秒计数加SysTick当前计数值, 分辨率1us, 约71.6分钟回绕一次.
+ *         SysTick优先级最低, 在其他中断中调用时计数可能已回绕而中断尚未执行,
+ *         此时由挂起标志补上1ms; 线程模式下读数期间被SysTick中断打断则重读
  * @param  无
  * @retval 系统运行时间(微秒)
  */
 uint32_t GetSysTime_us(void)
 {
-    return SystemTick_ms * 1000;
+    uint32_t ms, val;
+    
+    do
+    {
+        ms = SystemTick_ms;
+        val = SysTick->VAL;
+        if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+        {
+            /* 已回绕但中断未执行, 重读计数值保证与ms+1一致 */
+            val = SysTick->VAL;
+            ms++;
+            break;
+        }
+    } while (ms != SystemTick_ms);
+    
+    return ms * 1000 + (SysTick->LOAD - val) / (SystemCoreClock / 1000000);
 }
 
 /**
@@ -113,3 +135,28 @@ void SysTickIncrement(void)
 {
     /* 这个函数保持为空，SysTick_Handler直接处理 */
 }
+
+/**
+ * @brief  初始化DWT周期计数器
+ * @note   用于测量代码段CPU周期数, 72MHz下约59.6秒回绕一次
+ * @param  无
+ * @retval 无
+ */
+void CycleCounter_Init(void)
+{
+    /* 使能跟踪单元, 清零并启动CYCCNT */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+}
+
+/**
+ * @brief  获取CPU周期计数
+ * @note   两次读数相减即为耗时周期数(无符号减法自动处理回绕)
+ * @param  无
+ * @retval 当前CYCCNT值
+ */
+uint32_t GetCycleCount(void)
+{
+    return DWT_CYCCNT;
+}
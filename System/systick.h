@@ -15,5 +15,7 @@ void Delay_us(uint32_t us);        // 微秒级延时
 uint32_t GetSysTime_ms(void);      // 获取系统运行时间(毫秒)
 uint32_t GetSysTime_us(void);      // 获取系统运行时间(微秒)
 void SysTickIncrement(void);       // SysTick中断调用的时间递增函数
+void CycleCounter_Init(void);      // 初始化DWT周期计数器
+uint32_t GetCycleCount(void);      // 获取CPU周期计数
 
 #endif /* __SYSTICK_H */
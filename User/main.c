@@ -9,42 +9,308 @@
 #include "usart.h"
 #include "interrupt.h"
 #include "systick.h"  
+#include "oversample.h"
+#include "filter.h"
+#include "health.h"
+#include "capture.h"
+#include "calib.h"
+#include "mains.h"
+#include "fft.h"
+#include "fusion.h"
+#include "adapt.h"
+#include "telemetry.h"
+#include "command.h"
 #include <stdio.h>
 #include <string.h>
 
+/* 温度采集参数: 256倍过采样抽取为16位, 采样率取工频的256倍(50Hz时12.8kHz),
+ * 每个抽取窗口恰好积分一个工频周期, 工频干扰及其谐波被抵消 */
+#define TEMP_MAINS_HZ       MAINS_HZ_50
+#define TEMP_OVS_RATIO      256
+#define TEMP_OVS_BITS       16
+
+/* 温度滤波链参数: 5点中值剔除尖峰, 再经一阶IIR(alpha = 0.25)平滑
+ * 系数按输出计, 各采样率档位都固定为约4个输出的时间常数, 不随档位重调: 升档正是为了更快跟踪
+ * 瞬变, 拐点频率随输出率提高是预期行为; 降档时每个输出已积分更多工频周期, 噪声由过采样压低.
+ * 最高档位(半个工频周期一个输出)残留的工频纹波经IIR衰减到约1/7 */
+#define TEMP_MEDIAN_LENGTH  5
+#define TEMP_IIR_ALPHA      8192
+
+/* 遥测输出: 上电默认文本模式便于调试, 0x1B命令切换为二进制帧(滤波输出按批差分打包) */
+#define TEMP_TELEMETRY_MODE TELEMETRY_MODE_ASCII
+
+/* 自适应采样率: 上电默认启用 */
+#define TEMP_ADAPT_ENABLE   1
+
+/* 传感器滞后补偿: 灌封LM35热时间常数约20s, 补偿高频增益8(噪声放大8倍) */
+#define TEMP_LEAD_TAU_MS    20000
+#define TEMP_LEAD_GAIN      8
+
+/* ADC后台校准间隔(ms): 补偿温漂引起的偏移/增益变化, 每次缺失约2帧 */
+#define TEMP_RECAL_INTERVAL_MS  600000
+
+/* 波形捕获斜率触发默认值: 相邻采样上升超过该值(LSB)触发 */
+#define CAPTURE_SLOPE_DEFAULT   16
+
+/* 超温报警回差(0.01°C): 超过阈值报警, 低于阈值减回差才解除 */
+#define TEMP_ALARM_HYSTERESIS   50
+
+/* 噪声频谱诊断: 以遥测帧发送, 先一个SPECTRUM信息帧, 再若干SPECTRUM_DATA数据帧 */
+#define SPECTRUM_IDLE           0           // 空闲
+#define SPECTRUM_CAPTURING      1           // 等待捕获窗口冻结
+#define SPECTRUM_READY          2           // 已计算, 等待发送信息帧
+#define SPECTRUM_SENDING        3           // 正在分帧发送数据
+#define SPECTRUM_TYPE_FULL      0x01        // 数据为N/2+1个uint16幅度
+#define SPECTRUM_TYPE_PEAKS     0x02        // 数据为若干(uint16频点, uint16幅度)
+#define SPECTRUM_FRAMES_PER_POLL 2          // 每次主循环最多发送的遥测帧数
+
+/* 温度文本行/状态帧发送周期(ms), 可由0x22命令修改 */
+#define TEMP_REPORT_PERIOD_MS   1000
+#define TEMP_REPORT_PERIOD_MIN  100
+
+/* 0x20命令可设置的阈值范围(0.01°C), 即LM35量程 */
+#define TEMP_THRESHOLD_MIN      (-5500)
+#define TEMP_THRESHOLD_MAX      15000
+
+/* 0x26复位前等待串口输出发完的最长时间(ms) */
+#define TEMP_RESET_FLUSH_MS     200
+
+/* 事件记录: 报警、故障、采样率、阈值等变化, 由0x25命令输出 */
+#define EVENT_LOG_SIZE          16          // 保留最近的事件数(2的幂)
+#define EVENT_LOG_TX_RESERVE    (EVENT_LOG_SIZE * 40 + 24)  // 输出整个记录所需的发送队列空间(字节)
+#define EVENT_ALARM             1           // 超温报警变化, 值为新状态
+#define EVENT_EARLY_ALARM       2           // 提前报警, 值为补偿后的温度(0.01°C)
+#define EVENT_FAULT             3           // 传感器故障变化, 值为 通道 << 8 | 故障标志
+#define EVENT_RATE              4           // 采样率变化, 值为采样率(Hz)
+#define EVENT_RECAL             5           // ADC后台校准完成, 值为缺失帧数
+#define EVENT_THRESHOLD         6           // 串口或按键修改阈值, 值为新阈值(0.01°C)
+#define EVENT_BAUD              7           // 串口波特率自动检测或回退, 值为新波特率
+
+/* 事件记录项 */
+typedef struct
+{
+    uint32_t time;                          // 发生时刻(ms)
+    int32_t value;                          // 事件值, 含义见EVENT_xxx
+    uint8_t code;                           // 事件类型 EVENT_xxx
+} Event_TypeDef;
+
 /* 定义全局变量 */
-float current_temp = 0.0f;           // 当前温度值
+int32_t current_temp = 0;            // 当前温度值(0.01°C), 已校准
+int32_t current_temp_nominal = 0;    // 当前温度标称值(0.01°C), 校准前
+uint16_t current_temp_counts = 0;    // 当前温度对应的ADC值(TEMP_OVS_BITS位)
 uint8_t temp_threshold_index = 1;    // 温度阈值索引，默认使用第二个阈值(30度)
-const float temp_thresholds[3] = {25.0f, 30.0f, 35.0f}; // 三档温度阈值
-float current_threshold = 30.0f;     // 当前温度阈值，默认30度
+const int32_t temp_thresholds[3] = {2500, 3000, 3500}; // 三档温度阈值(0.01°C)
+int32_t current_threshold = 3000;    // 当前温度阈值(0.01°C)，默认30度
+uint16_t current_threshold_counts = 0; // 当前温度阈值对应的ADC值，与current_temp_counts直接比较
+uint16_t threshold_vdda = 0;         // 换算current_threshold_counts时的VDDA(mV)
+uint16_t current_release_counts = 0; // 报警解除点(阈值减回差)对应的ADC值
 uint8_t system_init_complete = 0;    // 系统初始化完成标志
-uint8_t serial_rx_flag = 0;          // 串口接收标志
-uint8_t serial_rx_data = 0;          // 串口接收的数据
 uint8_t key_pressed_flag = 0;        // 按键按下标志
+uint16_t mains_hz = TEMP_MAINS_HZ;   // 当前同步的工频频率(Hz)
+uint8_t spectrum_state = SPECTRUM_IDLE; // 频谱诊断状态
+uint8_t spectrum_log2n = FFT_LOG2N_MIN; // 频谱点数log2(N)
+uint8_t spectrum_peaks = 0;          // 峰值个数, 0为发送完整幅度谱
+uint8_t *spectrum_data = 0;          // 借用的捕获缓冲区, 保存幅度谱或峰值
+uint16_t spectrum_count = 0;         // 待发送的频点/峰值个数
+uint16_t spectrum_index = 0;         // 已发送个数
+uint8_t spectrum_item = 0;           // 每个频点/峰值的字节数
+uint32_t spectrum_time = 0;          // 窗口借出时刻(us), 作为各帧时间戳
+uint8_t spectrum_info[16];           // 信息帧负载
+Oversample_TypeDef temp_oversample;  // 温度通道过采样抽取器
+Filter_ChainTypeDef temp_filter;     // 温度通道滤波链, 作用于过采样输出
+volatile uint16_t temp_filtered = 0; // 滤波后的温度ADC值(TEMP_OVS_BITS位)
+volatile uint8_t temp_filtered_ready = 0; // 新滤波输出标志
+volatile uint32_t temp_sample_time = 0; // 滤波输出对应抽取窗口最后一帧的采样时刻(us)
+uint32_t current_temp_time = 0;      // 当前温度的采样时刻(us, GetSysTime_us时基)
+ADC_ChannelDataTypeDef sensor_data[ADC_MAX_READ_CHANNELS]; // 各通道最新读数, 最后一个为板温
+uint8_t sensor_count = 0;            // 读数通道数(含板温)
+Health_TypeDef sensor_health[ADC_MAX_FRAME_WIDTH]; // 各通道健康监测器
+uint8_t reported_faults[ADC_MAX_FRAME_WIDTH]; // 已通过串口报告的故障标志
+Capture_TypeDef temp_capture;        // 主探头波形捕获器
+Fusion_TypeDef temp_fusion;          // 冗余探头卡尔曼融合器
+uint16_t fused_block[ADC_BLOCK_SIZE]; // 一个数据块的逐帧融合估计(Q4计数)
+uint32_t fusion_channel_mask = 0;    // 参与融合的帧内通道位掩码
+Filter_StageTypeDef temp_lead;       // 传感器滞后补偿级, 作用于滤波输出
+volatile int32_t temp_lead_counts = 0; // 补偿后的温度ADC值(TEMP_OVS_BITS位, 可能越界)
+uint32_t lead_tau_ms = TEMP_LEAD_TAU_MS; // 传感器时间常数(ms), 0为不补偿
+int32_t current_temp_lead = 0;       // 补偿后的温度估计(0.01°C)
+Telemetry_BatchTypeDef temp_batch;   // 主探头批量遥测帧缓存
+Telemetry_BatchTypeDef lead_batch;   // 滞后补偿估计批量遥测帧缓存
+uint16_t current_lead_counts = 0;    // 补偿后的温度ADC值, 已限幅
+uint8_t early_alarm = 0;             // 提前报警状态
+Adapt_TypeDef temp_adapt;            // 自适应采样率控制器
+uint32_t early_alarm_time = 0;       // 提前报警时刻(ms)
+volatile uint8_t snapshot_ready = 0; // 快照完成标志
+volatile uint8_t snapshot_channel = 0;   // 快照通道
+volatile uint16_t snapshot_value = 0;    // 快照原始值
+uint32_t report_period_ms = TEMP_REPORT_PERIOD_MS; // 温度文本行/状态帧发送周期(ms)
+Event_TypeDef event_log[EVENT_LOG_SIZE]; // 事件记录(环形)
+uint32_t event_count = 0;            // 累计记录的事件数
+
+/* 传感器通道表: 第一个通道为主LM35探头, 其余为附加探头(PA0/PA1已用于LED, 勿配置) */
+const ADC_ChannelConfigTypeDef sensor_channels[] =
+{
+    {ADC_Channel_2, ADC_SampleTime_239Cycles5, ADC_CENTI_SCALE_Q16, 0, 3000},    // PA2 主探头
+    /* {ADC_Channel_3, ADC_SampleTime_239Cycles5, ADC_CENTI_SCALE_Q16, 0, 3000}, */ // PA3 附加探头示例
+};
+#define SENSOR_CHANNEL_COUNT    (sizeof(sensor_channels) / sizeof(sensor_channels[0]))
+
+/* 融合探头表: 装在同一物体上的冗余探头的帧内通道序号, 融合结果作为当前温度;
+ * 须为同型号探头, 校准表取第一个探头的 */
+const uint8_t fusion_channels[] =
+{
+    0,      // PA2 主探头
+    /* 1, */    // PA3 冗余探头示例
+};
+#define FUSION_PROBE_COUNT      (sizeof(fusion_channels) / sizeof(fusion_channels[0]))
 
 
 void SystemInit(void);               // 系统初始化
 void LED_Control(void);              // LED控制函数
-void Process_Serial_Command(void);   // 处理串口命令
 void Send_Temperature(void);         // 发送温度数据
 void Check_Temperature(void);        // 检测温度并更新LED状态
 void Process_Key(void); 
+void Set_Threshold(int32_t threshold);  // 设置温度阈值
+int Format_Temperature(char *buffer, int32_t centi); // 温度值格式化为"xx.x"
+static void Alarm_Output(uint8_t alarm);  // 驱动报警输出
+static void Watchdog_Alarm(uint8_t alarm); // 模拟看门狗报警回调
+void Report_Faults(void);            // 报告传感器故障变化
+static void Snapshot_Done(uint8_t channel, uint16_t value); // 快照完成回调
+void Send_Snapshot(void);            // 发送快照结果
+static void Process_ADC_Block(const ADC_BlockTypeDef *block); // ADC数据块处理
+static void Update_Channel_Threshold(uint8_t channel); // 按校准表重算通道阈值
+void Send_Mains_Rejection(void);     // 测量并发送工频抑制量
+void Process_Spectrum(void);         // 频谱诊断计算和发送
+uint8_t Lead_Config(uint32_t tau_ms); // 配置传感器滞后补偿
+uint32_t Apply_Sample_Rate(uint8_t level); // 按档位设置采样率
+void Check_Early_Alarm(void);        // 按补偿后的温度提前报警
+void Process_Recal(void);            // 定时ADC后台校准及结果报告
+static uint8_t Telemetry_Flags(void); // 当前报警状态对应的遥测标志
+void Send_Sample_Frames(void);       // 二进制模式发送本次滤波输出
+void Send_Status_Frames(void);       // 二进制模式发送附加探头和系统状态
+static void Log_Event(uint8_t code, int32_t value); // 记录一个事件
+void Process_Baud(void);             // 应用自动检测的波特率, 协商切换超时回退
+
+/* 串口命令处理函数, 参数含义见各函数说明 */
+static void Cmd_GetThreshold(uint8_t opcode, const uint8_t *args);
+static void Cmd_OvsCycles(uint8_t opcode, const uint8_t *args);
+static void Cmd_FilterCycles(uint8_t opcode, const uint8_t *args);
+static void Cmd_Snapshot(uint8_t opcode, const uint8_t *args);
+static void Cmd_CaptureArm(uint8_t opcode, const uint8_t *args);
+static void Cmd_CaptureTrigger(uint8_t opcode, const uint8_t *args);
+static void Cmd_Calib(uint8_t opcode, const uint8_t *args);
+static void Cmd_Mains(uint8_t opcode, const uint8_t *args);
+static void Cmd_MainsRejection(uint8_t opcode, const uint8_t *args);
+static void Cmd_Spectrum(uint8_t opcode, const uint8_t *args);
+static void Cmd_LeadTau(uint8_t opcode, const uint8_t *args);
+static void Cmd_Adaptive(uint8_t opcode, const uint8_t *args);
+static void Cmd_Recal(uint8_t opcode, const uint8_t *args);
+static void Cmd_SerialStats(uint8_t opcode, const uint8_t *args);
+static void Cmd_TelemetryMode(uint8_t opcode, const uint8_t *args);
+static void Cmd_SetThreshold(uint8_t opcode, const uint8_t *args);
+static void Cmd_SampleRate(uint8_t opcode, const uint8_t *args);
+static void Cmd_ReportPeriod(uint8_t opcode, const uint8_t *args);
+static void Cmd_FilterConfig(uint8_t opcode, const uint8_t *args);
+static void Cmd_Stats(uint8_t opcode, const uint8_t *args);
+static void Cmd_DumpLog(uint8_t opcode, const uint8_t *args);
+static void Cmd_Reset(uint8_t opcode, const uint8_t *args);
+static void Cmd_BaudSwitch(uint8_t opcode, const uint8_t *args);
+static void Cmd_BaudConfirm(uint8_t opcode, const uint8_t *args);
+
+/* 串口命令表: 按操作码索引, 帧为操作码 + 定长参数(多字节值均为大端) */
+static const Command_TypeDef command_table[COMMAND_OPCODE_COUNT] =
+{
+    [0x01] = {Cmd_GetThreshold, 0},     // 查询阈值
+    [0x02] = {Cmd_OvsCycles, 0},        // 过采样开销
+    [0x03] = {Cmd_FilterCycles, 0},     // 滤波链开销
+    [0x04] = {Cmd_Snapshot, 0},         // 主探头快照
+    [0x05] = {Cmd_CaptureArm, 0},       // 捕获布防: 阈值触发
+    [0x06] = {Cmd_CaptureArm, 0},       // 捕获布防: 斜率触发
+    [0x07] = {Cmd_CaptureArm, 0},       // 捕获布防: 按键触发
+    [0x08] = {Cmd_CaptureTrigger, 0},   // 手动触发捕获
+    [0x10] = {Cmd_Calib, 3},            // 添加校准点 <ch> <ref_hi> <ref_lo>
+    [0x11] = {Cmd_Calib, 1},            // 清除校准表 <ch>
+    [0x12] = {Cmd_Calib, 0},            // 保存校准表
+    [0x13] = {Cmd_Calib, 1},            // 输出校准表 <ch>
+    [0x14] = {Cmd_Mains, 1},            // 工频频率 <hz>
+    [0x15] = {Cmd_MainsRejection, 0},   // 工频抑制量
+    [0x16] = {Cmd_Spectrum, 3},         // 噪声频谱 <log2n> <抽取倍数> <峰值数>
+    [0x17] = {Cmd_LeadTau, 2},          // 滞后补偿时间常数 <tau_hi> <tau_lo>
+    [0x18] = {Cmd_Adaptive, 1},         // 自适应采样率 <0/1>
+    [0x19] = {Cmd_Recal, 0},            // ADC后台校准
+    [0x1A] = {Cmd_SerialStats, 0},      // 串口溢出统计
+    [0x1B] = {Cmd_TelemetryMode, 1},    // 遥测模式 <0/1>
+    [0x20] = {Cmd_SetThreshold, 2},     // 设置阈值 <hi> <lo>
+    [0x21] = {Cmd_SampleRate, 1},       // 固定采样率档位 <level>
+    [0x22] = {Cmd_ReportPeriod, 2},     // 发送周期 <hi> <lo>
+    [0x23] = {Cmd_FilterConfig, 3},     // 滤波链参数 <median> <alpha_hi> <alpha_lo>
+    [0x24] = {Cmd_Stats, 0},            // 命令处理统计
+    [0x25] = {Cmd_DumpLog, 0},          // 输出事件记录
+    [0x26] = {Cmd_Reset, 0},            // 软件复位
+    [0x27] = {Cmd_BaudSwitch, 4},       // 协商切换波特率 <b3> <b2> <b1> <b0>
+    [0x28] = {Cmd_BaudConfirm, 0},      // 以新波特率确认切换
+};
 
 /* 主函数 */
 int main(void)
 {
+    uint8_t i;
+    
     /* 系统初始化 */
     uesr_SystemInit();
     
     /* 初始化SysTick精确时间系统 */
     SysTick_Init();
+    CycleCounter_Init();
     
     /* 各模块初始化 */
-    ADC_Config();    // 配置ADC，50Hz采样率
+    ADC_Config();    // 配置ADC，TIM3定时触发采样
+    ADC_ScanConfig(sensor_channels, SENSOR_CHANNEL_COUNT);
+    Oversample_Init(&temp_oversample, TEMP_OVS_RATIO, TEMP_OVS_BITS);
+    Oversample_SetInputBits(&temp_oversample, 12 + FUSION_OUT_FRAC_BITS); // 输入为融合估计
+    Fusion_Init(&temp_fusion, fusion_channels, FUSION_PROBE_COUNT);
+    for (i = 0; i < FUSION_PROBE_COUNT; i++)
+    {
+        fusion_channel_mask |= 1u << fusion_channels[i];
+    }
+    for (i = 0; i < ADC_MAX_FRAME_WIDTH; i++)
+    {
+        Health_Init(&sensor_health[i]);
+    }
+    Capture_Init(&temp_capture, 0);
+    Filter_ChainInit(&temp_filter);
+    Filter_MedianInit(Filter_ChainAddStage(&temp_filter), TEMP_MEDIAN_LENGTH);
+    Filter_IIRInit(Filter_ChainAddStage(&temp_filter), TEMP_IIR_ALPHA);
+    ADC_SetHalfCpltCallback(Process_ADC_Block);
+    ADC_SetCpltCallback(Process_ADC_Block);
+    Adapt_Init(&temp_adapt, TEMP_ADAPT_ENABLE);
+    Apply_Sample_Rate(ADAPT_LEVEL_DEFAULT);   // 设置采样率, 同时配置滞后补偿
+    Calib_Init();    // 加载Flash中的校准表, 阈值按校准表反算
+    for (i = 1; i < SENSOR_CHANNEL_COUNT; i++)
+    {
+        Update_Channel_Threshold(i);
+    }
+    Set_Threshold(current_threshold);
     PWM_Config();    // 配置PWM，用于呼吸灯效果
-    USART_Config();  // 配置串口，波特率9600
+    USART_Config();  // 配置串口，上电波特率9600
+    USART_AutoBaudStart();  // 对端先发同步字节0x55时自动切换到其波特率
+    Telemetry_Init(TEMP_TELEMETRY_MODE);
+    Telemetry_BatchInit(&temp_batch, 0);
+    Telemetry_BatchInit(&lead_batch, TELEMETRY_CHANNEL_LEAD);
+    Command_Init(command_table);
     GPIO_Config();   // 配置GPIO
     EXTI_Config();   // 配置外部中断
+    ADC_SetWatchdogCallback(Watchdog_Alarm); // 报警输出就绪后由看门狗中断直接驱动
+    
+#ifdef ADC_FIXED_POINT_SELFTEST
+    /* 定点温度转换精度自检, 结果通过串口输出 */
+    {
+        char selftest_buffer[40];
+        sprintf(selftest_buffer, "Fixed-point max error: %lu/100 C\r\n",
+                (unsigned long)ADC_FixedPointSelfTest());
+        USART_SendString(USART1, selftest_buffer);
+    }
+#endif
     
     /* 系统启动指示：绿灯闪烁2次 */
     GPIO_SetBits(GPIOA, GPIO_Pin_0);    // 绿灯亮
@@ -66,11 +332,58 @@ int main(void)
     /* 主循环修改 */
     while (1)
     {
-        /* 采集温度数据 */
-        current_temp = ADC_GetTemperature();
+        /* 采集温度数据: 取最新的过采样、滤波结果 */
+        if (temp_filtered_ready)
+        {
+            temp_filtered_ready = 0;
+            current_temp_counts = temp_filtered;
+            current_temp_time = temp_sample_time;
+            current_temp_nominal = ADC_ConvertTemperature(current_temp_counts, TEMP_OVS_BITS);
+            current_temp = Calib_Apply(0, current_temp_nominal);
+            
+            /* 补偿输出阶跃时会过冲, 限幅到ADC值范围 */
+            if (temp_lead_counts < 0)
+                current_lead_counts = 0;
+            else if (temp_lead_counts > 0xFFFF)
+                current_lead_counts = 0xFFFF;
+            else
+                current_lead_counts = (uint16_t)temp_lead_counts;
+            current_temp_lead = Calib_Apply(0, ADC_ConvertTemperature(current_lead_counts, TEMP_OVS_BITS));
+            
+            /* 二进制模式下每个滤波输出都发送 */
+            if (Telemetry_GetMode() == TELEMETRY_MODE_BINARY)
+                Send_Sample_Frames();
+        }
+        
+        /* 自适应采样率控制器要求换档 */
+        if (temp_adapt.target != temp_adapt.level)
+        {
+            char rate_buffer[32];
+            sprintf(rate_buffer, "Rate: %luHz\r\n", (unsigned long)Apply_Sample_Rate(temp_adapt.target));
+            USART_SendString(USART1, rate_buffer);
+        }
+        
+        /* 一次读取所有通道的最新值 */
+        sensor_count = ADC_ReadAll(sensor_data);
+        
+        /* VDDA变化后阈值须重新换算到ADC计数空间 */
+        if (ADC_GetSupplyVoltage() != threshold_vdda)
+        {
+            Set_Threshold(current_threshold);
+        }
+        
+        /* 看门狗触发一次后关闭中断, 主探头滤波值离开回差带后重新使能, 避免噪声反复触发 */
+        if (temp_fusion.valid != 0)
+            ADC_WatchdogRearm(current_temp_counts >> (TEMP_OVS_BITS - 12));
     
         /* 检测温度并更新LED状态 */
         Check_Temperature();
+        
+        /* 滞后补偿通道提前报警 */
+        Check_Early_Alarm();
+        
+        /* 传感器故障变化时通过串口报告 */
+        Report_Faults();
     
         /* 更新呼吸灯效果 */
         PWM_UpdateBreathingEffect();
@@ -81,86 +394,959 @@ int main(void)
         /* 定时发送温度数据 */
      Send_Temperature();
     
-        /* 处理串口接收到的命令 */
-        if (serial_rx_flag)
-        {
-            Process_Serial_Command();
-            serial_rx_flag = 0;
-        }
+        /* 波特率切换须在取命令之前, 切换前收到的字节随之丢弃 */
+        Process_Baud();
+        
+        /* 处理接收缓冲区中的完整命令, 每次循环条数有上限; 以当前波特率收到有效命令说明
+         * 链路可用, 关闭自动波特率检测, 以免命令参数中的0x55被当作同步字节 */
+        if (Command_Poll() > 0)
+            USART_AutoBaudStop();
+        
+        /* 发送已完成的快照 */
+        Send_Snapshot();
+        
+        /* 定时ADC后台校准 */
+        Process_Recal();
+        
+        /* 频谱诊断借用捕获窗口, 须在普通波形发送之前处理 */
+        Process_Spectrum();
+        
+        /* 捕获窗口冻结后每次循环发送一行, 不阻塞正常监测; 频谱诊断进行中窗口归其所有 */
+        if (spectrum_state == SPECTRUM_IDLE)
+            Capture_Stream(&temp_capture);
     
         /* 精确延时20ms，控制主循环频率50Hz */
         Delay_ms(20);
     }
 }
 
-/* 检测温度并更新LED状态 */
+/* 检测温度并更新LED状态
+ * 主探头超温由ADC模拟看门狗在中断中直接报警, 此处汇总融合结果和其余附加探头;
+ * 有故障的通道读数不可信, 不参与超温判断 */
 void Check_Temperature(void)
 {
-    if (current_temp > current_threshold)
+    static uint8_t logged_alarm = 0;
+    uint8_t alarm = 0, i;
+    uint8_t primary_ok = (Health_GetFaults(&sensor_health[0]) == HEALTH_FAULT_NONE);
+    
+    /* 融合估计已换算到ADC计数空间, 直接比较整数; 全部融合探头故障时不判断 */
+    if (temp_fusion.valid != 0 && current_temp_counts > current_threshold_counts)
+        alarm = 1;
+    
+    /* 未参与融合的附加探头按各自通道阈值判断(最后一个为板温, 不报警) */
+    for (i = 1; i + 1 < sensor_count; i++)
+    {
+        if (fusion_channel_mask & (1u << i))
+            continue;
+        if (Health_GetFaults(&sensor_health[i]) == HEALTH_FAULT_NONE)
+            alarm |= sensor_data[i].alarm;
+    }
+    
+    /* 读取看门狗状态并输出期间屏蔽ADC中断, 防止覆盖中断中刚写入的报警 */
+    NVIC_DisableIRQ(ADC1_2_IRQn);
+    if (primary_ok)
+        alarm |= ADC_GetWatchdogAlarm();
+    Alarm_Output(alarm);
+    NVIC_EnableIRQ(ADC1_2_IRQn);
+    
+    if (alarm != logged_alarm)
     {
-        /* 超温报警：绿灯灭，红灯呼吸效果 */
+        logged_alarm = alarm;
+        Log_Event(EVENT_ALARM, alarm);
+    }
+}
+
+/* 模拟看门狗报警回调, 在ADC1_2中断中调用
+ * 主探头已报故障, 或触发点本身贴轨(短路/断线, 窗口判定尚未完成)时不报警 */
+static void Watchdog_Alarm(uint8_t alarm)
+{
+    if (alarm && (Health_GetFaults(&sensor_health[0]) != HEALTH_FAULT_NONE ||
+                  Health_CheckSample(&sensor_health[0], ADC_GetValue()) != HEALTH_FAULT_NONE))
+        return;
+    
+    Alarm_Output(alarm);
+}
+
+/* 按补偿后的温度提前报警
+ * 与主报警独立: 补偿值越过阈值即置位PB13并报告, 低于解除点撤销;
+ * 主报警随后出现时报告提前量 */
+void Check_Early_Alarm(void)
+{
+    static uint8_t main_alarm_seen = 0;
+    char response[64] = {0};
+    char value_buffer[12] = {0};
+    uint8_t main_alarm = GPIO_ReadOutputDataBit(GPIOB, GPIO_Pin_12);
+    
+    if (temp_fusion.valid == 0 || lead_tau_ms == 0)
+    {
+        /* 无可信读数或未启用补偿 */
+        if (early_alarm)
+        {
+            early_alarm = 0;
+            GPIO_ResetBits(GPIOB, GPIO_Pin_13);
+        }
+    }
+    else if (!early_alarm && current_lead_counts > current_threshold_counts)
+    {
+        early_alarm = 1;
+        early_alarm_time = GetSysTime_ms();
+        GPIO_SetBits(GPIOB, GPIO_Pin_13);
+        Format_Temperature(value_buffer, current_temp_lead);
+        sprintf(response, "Early alarm: lead %s°C\r\n", value_buffer);
+        USART_SendString(USART1, response);
+        Log_Event(EVENT_EARLY_ALARM, current_temp_lead);
+    }
+    else if (early_alarm && current_lead_counts < current_release_counts)
+    {
+        early_alarm = 0;
+        GPIO_ResetBits(GPIOB, GPIO_Pin_13);
+    }
+    
+    if (main_alarm && !main_alarm_seen && early_alarm)
+    {
+        sprintf(response, "Alarm confirmed %lums after early alarm\r\n",
+                (unsigned long)(GetSysTime_ms() - early_alarm_time));
+        USART_SendString(USART1, response);
+    }
+    main_alarm_seen = main_alarm;
+}
+
+/* 配置传感器滞后补偿, 输入为滤波输出(采样率 / 过采样倍率); 返回Filter_LeadInit的结果, 2为tau过短不补偿 */
+uint8_t Lead_Config(uint32_t tau_ms)
+{
+    uint8_t result;
+    
+    lead_tau_ms = tau_ms;
+    NVIC_DisableIRQ(DMA1_Channel1_IRQn);
+    result = Filter_LeadInit(&temp_lead, tau_ms, ADC_GetSampleRate() * 1000 / TEMP_OVS_RATIO, TEMP_LEAD_GAIN);
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+    
+    return result;
+}
+
+/* 按档位设置采样率, 同步更新依赖输出周期的控制器和滞后补偿, 返回实际采样率 */
+uint32_t Apply_Sample_Rate(uint8_t level)
+{
+    uint32_t rate;
+    
+    NVIC_DisableIRQ(DMA1_Channel1_IRQn);
+    rate = ADC_SetSampleRate(Adapt_GetRate(level, Mains_SyncRate(mains_hz, TEMP_OVS_RATIO)));
+    Adapt_SetLevel(&temp_adapt, level, (uint32_t)((uint64_t)TEMP_OVS_RATIO * 1000000 / rate));
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+    Lead_Config(lead_tau_ms);
+    Log_Event(EVENT_RATE, (int32_t)rate);
+    
+    return rate;
+}
+
+/* 报告传感器故障变化 */
+void Report_Faults(void)
+{
+    char response[64] = {0};
+    char fault_buffer[40] = {0};
+    uint8_t faults, i;
+    
+    for (i = 0; i + 1 < sensor_count; i++)
+    {
+        faults = Health_GetFaults(&sensor_health[i]);
+        if (faults != reported_faults[i])
+        {
+            Health_FormatFaults(fault_buffer, faults);
+            sprintf(response, "Sensor CH%u: %s\r\n", i, fault_buffer);
+            USART_SendString(USART1, response);
+            reported_faults[i] = faults;
+            Log_Event(EVENT_FAULT, (int32_t)i << 8 | faults);
+        }
+    }
+}
+
+/* 驱动报警输出, 主循环和ADC看门狗中断共用 */
+static void Alarm_Output(uint8_t alarm)
+{
+    if (alarm)
+    {
+        /* 超温报警：报警输出有效，绿灯灭，红灯呼吸效果 */
+        GPIO_SetBits(GPIOB, GPIO_Pin_12);   // 报警输出
         GPIO_ResetBits(GPIOA, GPIO_Pin_0);  // 绿灯灭
         PWM_SetBreathingEffect(1);          // 启动红灯呼吸效果
     }
     else
     {
-        /* 温度正常：绿灯亮，红灯灭 */
+        /* 温度正常：报警输出无效，绿灯亮，红灯灭 */
+        GPIO_ResetBits(GPIOB, GPIO_Pin_12); // 撤销报警输出
         GPIO_SetBits(GPIOA, GPIO_Pin_0);    // 绿灯亮
         PWM_SetBreathingEffect(0);          // 关闭红灯呼吸效果
     }
 }
 
+/* 设置温度阈值, 同时预先换算到ADC计数空间
+ * 阈值为校准后的温度, 先经校准表反算为标称值, 比较时无需逐点校准 */
+void Set_Threshold(int32_t threshold)
+{
+    int32_t nominal = Calib_Invert(0, threshold);
+    
+    current_threshold = threshold;
+    threshold_vdda = ADC_GetSupplyVoltage();
+    current_threshold_counts = (uint16_t)ADC_TemperatureToCounts(nominal, TEMP_OVS_BITS);
+    current_release_counts = (uint16_t)ADC_TemperatureToCounts(Calib_Invert(0, threshold - TEMP_ALARM_HYSTERESIS),
+                                                               TEMP_OVS_BITS);
+    ADC_SetChannelThreshold(0, nominal);
+    ADC_WatchdogConfig((uint16_t)ADC_TemperatureToCounts(nominal, 12),
+                       (uint16_t)ADC_TemperatureToCounts(Calib_Invert(0, threshold - TEMP_ALARM_HYSTERESIS), 12));
+}
+
+/* 附加探头阈值按校准表反算到标称值空间, 主探头由Set_Threshold处理 */
+static void Update_Channel_Threshold(uint8_t channel)
+{
+    if (channel == 0)
+        Set_Threshold(current_threshold);
+    else if (channel < SENSOR_CHANNEL_COUNT)
+        ADC_SetChannelThreshold(channel, Calib_Invert(channel, sensor_channels[channel].threshold));
+}
+
+/* 温度值(0.01°C)格式化为一位小数字符串, 不使用浮点printf */
+int Format_Temperature(char *buffer, int32_t centi)
+{
+    uint32_t tenths;
+    
+    /* 四舍五入到0.1°C */
+    tenths = (uint32_t)((centi < 0 ? -centi : centi) + 5) / 10;
+    
+    return sprintf(buffer, "%s%lu.%lu", (centi < 0 && tenths != 0) ? "-" : "",
+                   (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+}
+
 /* 发送温度数据 */
 void Send_Temperature(void)
 {
     static uint32_t last_send_time = 0;
     uint32_t current_time = 0;
-    char temp_buffer[20] = {0};
+    char temp_buffer[128 + 16 * ADC_MAX_READ_CHANNELS] = {0};
+    char value_buffer[12] = {0};
+    int32_t sigma;
+    uint16_t sigma_counts;
+    int length;
+    uint8_t i;
     
     /* 获取当前精确时间 */
     current_time = GetSysTime_ms();
     
-    /* 每1000ms发送一次温度数据 */
-    if (current_time - last_send_time >= 1000)
+    /* 每report_period_ms发送一次温度数据 */
+    if (current_time - last_send_time >= report_period_ms)
     {
-        sprintf(temp_buffer, "Temp: %.1f°C\r\n", current_temp);
+        /* 二进制模式下主探头随滤波输出发送, 此处只发送附加探头和系统状态 */
+        if (Telemetry_GetMode() == TELEMETRY_MODE_BINARY)
+        {
+            Send_Status_Frames();
+            last_send_time = current_time;
+            return;
+        }
+        
+        /* 融合探头全部故障时不输出温度; 否则附带融合估计标准差(0.01°C) */
+        if (temp_fusion.valid == 0)
+        {
+            length = sprintf(temp_buffer, "Temp: FAULT");
+        }
+        else
+        {
+            Fusion_GetEstimate(&temp_fusion, &sigma_counts);
+            sigma = ADC_ConvertTemperature(sigma_counts, 12 + FUSION_OUT_FRAC_BITS);
+            Format_Temperature(value_buffer, current_temp);
+            length = sprintf(temp_buffer, "Temp: %s°C (+/-%ld.%02ld)", value_buffer,
+                             (long)(sigma / 100), (long)(sigma % 100));
+            if (lead_tau_ms)
+            {
+                Format_Temperature(value_buffer, current_temp_lead);
+                length += sprintf(temp_buffer + length, ", Lead: %s°C", value_buffer);
+            }
+        }
+        
+        /* 附加探头依次追加 */
+        for (i = 1; i + 1 < sensor_count; i++)
+        {
+            if (Health_GetFaults(&sensor_health[i]) != HEALTH_FAULT_NONE)
+            {
+                length += sprintf(temp_buffer + length, ", CH%u: FAULT", i);
+                continue;
+            }
+            Format_Temperature(value_buffer, Calib_Apply(i, sensor_data[i].value));
+            length += sprintf(temp_buffer + length, ", CH%u: %s°C", i, value_buffer);
+        }
+        
+        /* 板温、VDDA估计值(Vrefint未校准, 约±3%)、当前采样率(输出间隔 = 过采样倍率 / 采样率)和温度的采样时刻 */
+        Format_Temperature(value_buffer, sensor_data[sensor_count - 1].value);
+        sprintf(temp_buffer + length, ", Board: %s°C, VDDA: ~%umV (uncal), Rate: %luHz, T: %luus\r\n", value_buffer,
+                (unsigned int)ADC_GetSupplyVoltage(), (unsigned long)ADC_GetSampleRate(),
+                (unsigned long)current_temp_time);
         USART_SendString(USART1, temp_buffer);
         last_send_time = current_time;
     }
 }
 
-/* 处理串口命令 */
-void Process_Serial_Command(void)
+/* 当前报警状态对应的遥测标志 */
+static uint8_t Telemetry_Flags(void)
 {
-    char response[30] = {0};
+    uint8_t flags = 0;
+    
+    if (GPIO_ReadOutputDataBit(GPIOB, GPIO_Pin_12))
+        flags |= TELEMETRY_FLAG_ALARM;
+    if (early_alarm)
+        flags |= TELEMETRY_FLAG_EARLY;
+    
+    return flags;
+}
+
+/* 二进制模式发送本次滤波输出: 主探头(融合结果)及滞后补偿估计, 时间戳为抽取窗口的采样时刻.
+ * 连续输出按通道批量差分打包, 满批、间隔或标志变化时成帧 */
+void Send_Sample_Frames(void)
+{
+    uint8_t flags = Telemetry_Flags();
+    
+    if (temp_fusion.valid == 0)
+        flags |= TELEMETRY_FLAG_FAULT;
+    
+    Telemetry_BatchPush(&temp_batch, current_temp_time, current_temp, flags);
+    if (lead_tau_ms)
+        Telemetry_BatchPush(&lead_batch, current_temp_time, current_temp_lead, flags);
+    else
+        Telemetry_BatchFlush(&lead_batch);
+}
+
+/* 二进制模式每秒发送附加探头读数和系统状态(板温、采样率、VDDA) */
+void Send_Status_Frames(void)
+{
+    uint32_t now = GetSysTime_us();
+    uint8_t i;
+    
+    for (i = 1; i + 1 < sensor_count; i++)
+    {
+        if (Health_GetFaults(&sensor_health[i]) != HEALTH_FAULT_NONE)
+            Telemetry_SendValue(i, now, 0, TELEMETRY_FLAG_FAULT);
+        else
+            Telemetry_SendValue(i, now, Calib_Apply(i, sensor_data[i].value), sensor_data[i].alarm ? TELEMETRY_FLAG_ALARM : 0);
+    }
+    
+    Telemetry_SendStatus(now, sensor_data[sensor_count - 1].value, ADC_GetSampleRate(),
+                         ADC_GetSupplyVoltage(), Telemetry_Flags());
+}
+
+/* 0x01: 返回当前温度阈值 */
+static void Cmd_GetThreshold(uint8_t opcode, const uint8_t *args)
+{
+    char response[32] = {0};
+    char value_buffer[12] = {0};
+    
+    Format_Temperature(value_buffer, current_threshold);
+    sprintf(response, "Threshold: %s°C\r\n", value_buffer);
+    USART_SendString(USART1, response);
+}
+
+/* 0x02: 返回过采样抽取的CPU开销 */
+static void Cmd_OvsCycles(uint8_t opcode, const uint8_t *args)
+{
+    char response[48] = {0};
+    
+    /* 两个计数最长各10位, 连同文字和结束符共37字节 */
+    snprintf(response, sizeof(response), "OVS: %lu/%lu cyc/out\r\n",
+             (unsigned long)temp_oversample.cycles_per_output,
+             (unsigned long)temp_oversample.cycles_max);
+    USART_SendString(USART1, response);
+}
+
+/* 0x03: 返回滤波链各级每采样CPU周期数(最近/峰值) */
+static void Cmd_FilterCycles(uint8_t opcode, const uint8_t *args)
+{
+    char response[80] = {0};
+    
+    sprintf(response, "FLT: median %lu/%lu, iir %lu/%lu cyc/sample\r\n",
+            (unsigned long)temp_filter.stage[0].cycles_per_sample,
+            (unsigned long)temp_filter.stage[0].cycles_max,
+            (unsigned long)temp_filter.stage[1].cycles_per_sample,
+            (unsigned long)temp_filter.stage[1].cycles_max);
+    USART_SendString(USART1, response);
+}
+
+/* 0x04: 主探头快照, 注入组立即转换, 不等待采样流 */
+static void Cmd_Snapshot(uint8_t opcode, const uint8_t *args)
+{
+    if (ADC_SnapshotRequest(sensor_channels[0].channel, Snapshot_Done))
+        USART_SendString(USART1, "Snapshot busy\r\n");
+}
+
+/* 0x05 ~ 0x07: 波形捕获布防, 0x05 阈值电平上升触发, 0x06 斜率触发, 0x07 按键(EXTI)触发
+ * 重新初始化以放弃进行中的频谱诊断, 恢复全速率捕获 */
+static void Cmd_CaptureArm(uint8_t opcode, const uint8_t *args)
+{
+    uint8_t result;
+    
+    spectrum_state = SPECTRUM_IDLE;
+    Capture_Init(&temp_capture, 0);
+    if (opcode == 0x05)
+        result = Capture_Arm(&temp_capture, CAPTURE_TRIG_RISING,
+                             (int32_t)ADC_TemperatureToCounts(Calib_Invert(0, current_threshold), 12),
+                             CAPTURE_PRE_DEFAULT);
+    else if (opcode == 0x06)
+        result = Capture_Arm(&temp_capture, CAPTURE_TRIG_SLOPE, CAPTURE_SLOPE_DEFAULT, CAPTURE_PRE_DEFAULT);
+    else
+        result = Capture_Arm(&temp_capture, CAPTURE_TRIG_EXTERNAL, 0, CAPTURE_PRE_DEFAULT);
+    
+    /* 阈值超出ADC量程等参数无效时布防失败, 如实回复 */
+    USART_SendString(USART1, result ? "Capture arm failed\r\n" : "Capture armed\r\n");
+}
+
+/* 0x08: 手动触发捕获 */
+static void Cmd_CaptureTrigger(uint8_t opcode, const uint8_t *args)
+{
+    if (Capture_Trigger(&temp_capture))
+        USART_SendString(USART1, "Capture not armed\r\n");
+}
+
+/* 校准命令
+ * 0x10 <ch> <ref_hi> <ref_lo>: 以通道当前读数为标称值, 记录参考温度(0.01°C, 有符号大端)
+ * 0x11 <ch>: 清除通道校准表
+ * 0x12: 校准表写入Flash(擦除期间约20ms不响应中断, 可能丢失一个数据块)
+ * 0x13 <ch>: 输出通道校准表 */
+static void Cmd_Calib(uint8_t opcode, const uint8_t *args)
+{
+    char response[64] = {0};
+    char nominal_buffer[12] = {0};
+    char value_buffer[12] = {0};
+    const Calib_TableTypeDef *table;
+    uint8_t channel;
+    int32_t nominal;
+    uint8_t k;
+    
+    if (opcode == 0x12)
+    {
+        USART_SendString(USART1, Calib_Save() ? "Calib save failed\r\n" : "Calib saved\r\n");
+        return;
+    }
     
-    if (serial_rx_data == 0x01)
+    /* 仅已配置的扫描通道可校准 */
+    channel = args[0];
+    if (channel >= SENSOR_CHANNEL_COUNT)
     {
-        /* 返回当前温度阈值 */
-        sprintf(response, "Threshold: %.1f°C\r\n", current_threshold);
+        USART_SendString(USART1, "Calib invalid channel\r\n");
+        return;
+    }
+    
+    if (opcode == 0x10)
+    {
+        nominal = (channel == 0) ? current_temp_nominal : sensor_data[channel].value;
+        if (Calib_AddPoint(channel, nominal, (int16_t)((args[1] << 8) | args[2])))
+        {
+            USART_SendString(USART1, "Calib point rejected\r\n");
+            return;
+        }
+        Update_Channel_Threshold(channel);
+    }
+    else if (opcode == 0x11)
+    {
+        Calib_Clear(channel);
+        Update_Channel_Threshold(channel);
+    }
+    
+    /* 添加、清除后同样回显当前校准表 */
+    table = Calib_GetTable(channel);
+    sprintf(response, "Calib CH%u: %u points\r\n", (unsigned int)channel, (unsigned int)table->count);
+    USART_SendString(USART1, response);
+    for (k = 0; k < table->count; k++)
+    {
+        Format_Temperature(nominal_buffer, table->x[k]);
+        Format_Temperature(value_buffer, table->y[k]);
+        sprintf(response, "  %s°C -> %s°C\r\n", nominal_buffer, value_buffer);
         USART_SendString(USART1, response);
     }
+}
+
+/* 0x14 <hz>: 切换同步的工频频率(50/60), 抽取窗口随之改为20ms/16.67ms */
+static void Cmd_Mains(uint8_t opcode, const uint8_t *args)
+{
+    char response[48] = {0};
+    
+    if (Mains_SyncRate(args[0], TEMP_OVS_RATIO) == 0)
+    {
+        USART_SendString(USART1, "Mains invalid frequency\r\n");
+        return;
+    }
+    
+    mains_hz = args[0];
+    sprintf(response, "Mains %uHz, rate %luHz\r\n", (unsigned int)mains_hz,
+            (unsigned long)Apply_Sample_Rate(temp_adapt.level));
+    USART_SendString(USART1, response);
+}
+
+/* 0x15: 测量并发送工频抑制量 */
+static void Cmd_MainsRejection(uint8_t opcode, const uint8_t *args)
+{
+    Send_Mains_Rejection();
+}
+
+/* 0x16 <log2n> <抽取倍数> <峰值数>: 捕获2^log2n个采样做FFT, 峰值数为0时发送完整幅度谱 */
+static void Cmd_Spectrum(uint8_t opcode, const uint8_t *args)
+{
+    if (args[0] < FFT_LOG2N_MIN || args[0] > FFT_LOG2N_MAX ||
+        args[2] > FFT_PEAKS_MAX || spectrum_state != SPECTRUM_IDLE ||
+        Capture_SetDecimation(&temp_capture, args[1] ? args[1] : 1) ||
+        Capture_SetLength(&temp_capture, (uint16_t)(1u << args[0])) ||
+        Capture_Arm(&temp_capture, CAPTURE_TRIG_EXTERNAL, 0, 0))
+    {
+        USART_SendString(USART1, "Spectrum busy or invalid\r\n");
+        return;
+    }
+    
+    spectrum_log2n = args[0];
+    spectrum_peaks = args[2];
+    spectrum_state = SPECTRUM_CAPTURING;
+    Capture_Trigger(&temp_capture);
+}
+
+/* 0x17 <tau_hi> <tau_lo>: 传感器时间常数(0.1s), 0为不补偿 */
+static void Cmd_LeadTau(uint8_t opcode, const uint8_t *args)
+{
+    char response[64] = {0};
+    
+    /* tau不足两个滤波输出周期时无法补偿, 如实回复; 实际增益可能因tau较短小于TEMP_LEAD_GAIN */
+    if (Lead_Config(((uint32_t)args[0] << 8 | args[1]) * 100) == 2)
+        sprintf(response, "Lead tau %lu.%lus too short, no compensation\r\n", (unsigned long)(lead_tau_ms / 1000),
+                (unsigned long)(lead_tau_ms % 1000 / 100));
     else
+        sprintf(response, "Lead tau %lu.%lus, gain %u.%02u\r\n", (unsigned long)(lead_tau_ms / 1000),
+                (unsigned long)(lead_tau_ms % 1000 / 100), (unsigned int)(temp_lead.u.lead.gain >> 8),
+                (unsigned int)((temp_lead.u.lead.gain & 0xFF) * 100 >> 8));
+    USART_SendString(USART1, response);
+}
+
+/* 0x18 <0/1>: 关闭/开启自适应采样率, 均从默认档位重新开始 */
+static void Cmd_Adaptive(uint8_t opcode, const uint8_t *args)
+{
+    char response[48] = {0};
+    
+    NVIC_DisableIRQ(DMA1_Channel1_IRQn);
+    Adapt_Init(&temp_adapt, args[0] ? 1 : 0);
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+    sprintf(response, "Adaptive %s, rate %luHz\r\n", temp_adapt.enabled ? "on" : "off",
+            (unsigned long)Apply_Sample_Rate(ADAPT_LEVEL_DEFAULT));
+    USART_SendString(USART1, response);
+}
+
+/* 0x19: 立即请求一次ADC后台校准, 完成后由Process_Recal报告 */
+static void Cmd_Recal(uint8_t opcode, const uint8_t *args)
+{
+    if (ADC_Recalibrate())
+        USART_SendString(USART1, "Recal busy or unsupported\r\n");
+    else
+        USART_SendString(USART1, "Recal requested\r\n");
+}
+
+/* 0x1A: 返回串口发送队列和接收缓冲区溢出统计 */
+static void Cmd_SerialStats(uint8_t opcode, const uint8_t *args)
+{
+    char response[64] = {0};
+    uint32_t dropped_bytes;
+    uint32_t overflows = USART_GetTxDropped(&dropped_bytes);
+    
+    sprintf(response, "TX: %lu overflows, %lu bytes dropped, %u free\r\n", (unsigned long)overflows,
+            (unsigned long)dropped_bytes, (unsigned int)USART_GetTxFree());
+    USART_SendString(USART1, response);
+    sprintf(response, "RX: %lu overflows, baud %lu\r\n", (unsigned long)USART_GetRxOverflow(),
+            (unsigned long)USART_GetBaudRate());
+    USART_SendString(USART1, response);
+}
+
+/* 0x1B <0/1>: 遥测输出切换为文本/二进制帧 */
+static void Cmd_TelemetryMode(uint8_t opcode, const uint8_t *args)
+{
+    /* 切换前发出缓存的采样 */
+    Telemetry_BatchFlush(&temp_batch);
+    Telemetry_BatchFlush(&lead_batch);
+    
+    if (Telemetry_SetMode(args[0]))
+        USART_SendString(USART1, "Telemetry mode invalid\r\n");
+    else
+        USART_SendString(USART1, args[0] ? "Telemetry: binary\r\n" : "Telemetry: ascii\r\n");
+}
+
+/* 0x20 <hi> <lo>: 设置温度阈值(0.01°C, 有符号大端), 限于LM35量程 */
+static void Cmd_SetThreshold(uint8_t opcode, const uint8_t *args)
+{
+    int32_t threshold = (int16_t)((args[0] << 8) | args[1]);
+    
+    if (threshold < TEMP_THRESHOLD_MIN || threshold > TEMP_THRESHOLD_MAX)
     {
-        /* 无效指令 */
-        USART_SendString(USART1, "invalid instruction.\r\n");
+        USART_SendString(USART1, "Threshold out of range\r\n");
+        return;
     }
+    
+    Set_Threshold(threshold);
+    Log_Event(EVENT_THRESHOLD, threshold);
+    Cmd_GetThreshold(opcode, args);
 }
 
-/* USART接收中断回调函数 */
-void USART1_IRQHandler(void)
+/* 0x21 <level>: 关闭自适应采样率, 固定在指定档位(0为最低); 0x18可重新开启自适应 */
+static void Cmd_SampleRate(uint8_t opcode, const uint8_t *args)
 {
-    if(USART_GetITStatus(USART1, USART_IT_RXNE) != RESET)
+    char response[48] = {0};
+    
+    if (args[0] >= ADAPT_LEVELS)
     {
-        /* 清除中断标志 */
-        USART_ClearITPendingBit(USART1, USART_IT_RXNE);
-        
-        /* 读取接收到的数据 */
-        serial_rx_data = USART_ReceiveData(USART1);
-        serial_rx_flag = 1;
+        USART_SendString(USART1, "Rate invalid level\r\n");
+        return;
+    }
+    
+    NVIC_DisableIRQ(DMA1_Channel1_IRQn);
+    Adapt_Init(&temp_adapt, 0);
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+    sprintf(response, "Rate: level %u, %luHz\r\n", (unsigned int)args[0],
+            (unsigned long)Apply_Sample_Rate(args[0]));
+    USART_SendString(USART1, response);
+}
+
+/* 0x22 <hi> <lo>: 设置温度文本行/状态帧发送周期(ms, 大端) */
+static void Cmd_ReportPeriod(uint8_t opcode, const uint8_t *args)
+{
+    char response[32] = {0};
+    uint32_t period = (uint32_t)args[0] << 8 | args[1];
+    
+    if (period < TEMP_REPORT_PERIOD_MIN)
+    {
+        USART_SendString(USART1, "Report period invalid\r\n");
+        return;
+    }
+    
+    report_period_ms = period;
+    sprintf(response, "Report period %lums\r\n", (unsigned long)report_period_ms);
+    USART_SendString(USART1, response);
+}
+
+/* 0x23 <median> <alpha_hi> <alpha_lo>: 重建滤波链, 中值窗口(奇数3~9) + IIR系数(Q15, 大端)
+ * 在DMA中断中使用, 重建期间屏蔽该中断; 滤波状态重新开始 */
+static void Cmd_FilterConfig(uint8_t opcode, const uint8_t *args)
+{
+    char response[48] = {0};
+    int16_t alpha = (int16_t)((args[1] << 8) | args[2]);
+    
+    if (args[0] < 3 || args[0] > FILTER_MEDIAN_MAX || (args[0] & 1) == 0 || alpha <= 0)
+    {
+        USART_SendString(USART1, "Filter config invalid\r\n");
+        return;
+    }
+    
+    NVIC_DisableIRQ(DMA1_Channel1_IRQn);
+    Filter_ChainInit(&temp_filter);
+    Filter_MedianInit(Filter_ChainAddStage(&temp_filter), args[0]);
+    Filter_IIRInit(Filter_ChainAddStage(&temp_filter), alpha);
+    NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+    sprintf(response, "Filter: median %u, alpha %d/32768\r\n", (unsigned int)args[0], (int)alpha);
+    USART_SendString(USART1, response);
+}
+
+/* 0x24: 返回命令处理统计(处理耗时最近/峰值及峰值对应的操作码)和运行时间 */
+static void Cmd_Stats(uint8_t opcode, const uint8_t *args)
+{
+    char response[80] = {0};
+    const Command_StatsTypeDef *stats = Command_GetStats();
+    
+    sprintf(response, "CMD: %lu done, %lu invalid, %lu timeout, %lu/%lu cyc (0x%02X)\r\n",
+            (unsigned long)stats->count, (unsigned long)stats->invalid, (unsigned long)stats->timeouts,
+            (unsigned long)stats->cycles_last, (unsigned long)stats->cycles_max,
+            (unsigned int)stats->opcode_max);
+    USART_SendString(USART1, response);
+    sprintf(response, "Uptime: %lums, %lu events\r\n", (unsigned long)GetSysTime_ms(),
+            (unsigned long)event_count);
+    USART_SendString(USART1, response);
+}
+
+/* 0x25: 按时间顺序输出事件记录中保留的事件 */
+static void Cmd_DumpLog(uint8_t opcode, const uint8_t *args)
+{
+    static const char *const event_names[] = {"", "alarm", "early", "fault", "rate", "recal", "threshold", "baud"};
+    char response[48] = {0};
+    const Event_TypeDef *event;
+    uint32_t first = (event_count > EVENT_LOG_SIZE) ? event_count - EVENT_LOG_SIZE : 0;
+    uint32_t k;
+    
+    /* 整个记录一次写入, 空间不足时不输出残缺的记录 */
+    if (USART_GetTxFree() < EVENT_LOG_TX_RESERVE)
+    {
+        USART_SendString(USART1, "Log busy\r\n");
+        return;
+    }
+    
+    sprintf(response, "Log: %lu events\r\n", (unsigned long)(event_count - first));
+    USART_SendString(USART1, response);
+    for (k = first; k < event_count; k++)
+    {
+        event = &event_log[k & (EVENT_LOG_SIZE - 1)];
+        sprintf(response, "  %lums %s %ld\r\n", (unsigned long)event->time,
+                event_names[event->code], (long)event->value);
+        USART_SendString(USART1, response);
+    }
+}
+
+/* 0x26: 发完已排队的输出后软件复位 */
+static void Cmd_Reset(uint8_t opcode, const uint8_t *args)
+{
+    USART_SendString(USART1, "Resetting\r\n");
+    USART_Flush(TEMP_RESET_FLUSH_MS);
+    NVIC_SystemReset();
+}
+
+/* 0x27 <b3> <b2> <b1> <b0>: 协商切换波特率(大端), 回复按原波特率发完后切换;
+ * 上位机须在USART_BAUD_CONFIRM_MS内以新波特率发送0x28确认, 否则回退. 切换前后收到的字节丢弃 */
+static void Cmd_BaudSwitch(uint8_t opcode, const uint8_t *args)
+{
+    char response[48] = {0};
+    uint32_t baud = (uint32_t)args[0] << 24 | (uint32_t)args[1] << 16 | (uint32_t)args[2] << 8 | args[3];
+    
+    if (baud < USART_BAUD_MIN || baud > USART_BAUD_MAX)
+    {
+        USART_SendString(USART1, "Baud invalid\r\n");
+        return;
+    }
+    
+    sprintf(response, "Baud: switching to %lu\r\n", (unsigned long)baud);
+    USART_SendString(USART1, response);
+    USART_BaudSwitch(baud);
+}
+
+/* 0x28: 以新波特率确认协商切换 */
+static void Cmd_BaudConfirm(uint8_t opcode, const uint8_t *args)
+{
+    char response[32] = {0};
+    
+    if (USART_BaudConfirm())
+    {
+        USART_SendString(USART1, "Baud: nothing to confirm\r\n");
+        return;
     }
+    
+    sprintf(response, "Baud confirmed: %lu\r\n", (unsigned long)USART_GetBaudRate());
+    USART_SendString(USART1, response);
 }
 
+/* 应用自动检测到的波特率, 协商切换超时未确认时回退; 回复按新波特率发送 */
+void Process_Baud(void)
+{
+    char response[32] = {0};
+    uint8_t event = USART_BaudPoll();
+    
+    if (event == USART_BAUD_EVENT_NONE)
+        return;
+    
+    sprintf(response, "Baud%s: %lu\r\n", (event == USART_BAUD_EVENT_FALLBACK) ? " fallback" : "",
+            (unsigned long)USART_GetBaudRate());
+    USART_SendString(USART1, response);
+    Log_Event(EVENT_BAUD, (int32_t)USART_GetBaudRate());
+}
+
+/* 记录一个事件, 只在主循环中调用; 保留最近EVENT_LOG_SIZE个 */
+static void Log_Event(uint8_t code, int32_t value)
+{
+    Event_TypeDef *event = &event_log[event_count & (EVENT_LOG_SIZE - 1)];
+    
+    event->time = GetSysTime_ms();
+    event->value = value;
+    event->code = code;
+    event_count++;
+}
+
+/* 测量并发送工频抑制量
+ * 按当前实际采样率和抽取参数, 分别测量同步工频、工频偏移1%和另一工频制式下的抑制量 */
+void Send_Mains_Rejection(void)
+{
+    char response[96] = {0};
+    uint32_t rate = ADC_GetSampleRate();
+    uint16_t other_hz = (mains_hz == MAINS_HZ_50) ? MAINS_HZ_60 : MAINS_HZ_50;
+    int32_t sync_db, drift_db, other_db;
+    
+    sync_db = Mains_MeasureRejection(rate, TEMP_OVS_RATIO, TEMP_OVS_BITS, (uint32_t)mains_hz * 1000);
+    drift_db = Mains_MeasureRejection(rate, TEMP_OVS_RATIO, TEMP_OVS_BITS, (uint32_t)mains_hz * 1010);
+    other_db = Mains_MeasureRejection(rate, TEMP_OVS_RATIO, TEMP_OVS_BITS, (uint32_t)other_hz * 1000);
+    
+    sprintf(response, "Mains rejection: %uHz %ld.%02lddB, +1%% %ld.%02lddB, %uHz %ld.%02lddB\r\n",
+            (unsigned int)mains_hz, (long)(sync_db / 100), (long)(sync_db % 100),
+            (long)(drift_db / 100), (long)(drift_db % 100),
+            (unsigned int)other_hz, (long)(other_db / 100), (long)(other_db % 100));
+    USART_SendString(USART1, response);
+}
+
+/* 频谱诊断计算和发送
+ * 捕获窗口冻结后借用其缓冲区原位完成FFT, 不另占RAM. 结果以遥测帧发送(与输出模式无关):
+ * 一个信息帧(TELEMETRY_TYPE_SPECTRUM)后跟若干数据帧(TELEMETRY_TYPE_SPECTRUM_DATA), 每帧自带
+ * CRC并整帧写入发送队列, 其他输出只会夹在帧之间, 接收端按起始序号拼接 */
+void Process_Spectrum(void)
+{
+    FFT_PeakTypeDef peaks[FFT_PEAKS_MAX];
+    uint8_t payload[TELEMETRY_PAYLOAD_MAX];
+    uint8_t frames = SPECTRUM_FRAMES_PER_POLL;
+    int16_t *data;
+    uint32_t start, rate, fft_cycles, post_cycles;
+    uint16_t count;
+    
+    if (spectrum_state == SPECTRUM_CAPTURING)
+    {
+        /* 窗口一冻结就借出, 与发送队列空间无关, 以免被Capture_Stream当作普通波形发送 */
+        data = (int16_t *)Capture_Claim(&temp_capture);
+        if (data == 0)
+            return;
+        spectrum_time = GetSysTime_us();
+    
+        start = GetCycleCount();
+        FFT_PrepareReal(data, spectrum_log2n);
+        FFT_Transform(data, spectrum_log2n);
+        fft_cycles = GetCycleCount() - start;
+    
+        start = GetCycleCount();
+        count = FFT_Magnitude(data, spectrum_log2n);
+        spectrum_item = 2;
+        if (spectrum_peaks)
+        {
+            count = FFT_FindPeaks((uint16_t *)data, count, peaks, spectrum_peaks);
+            spectrum_item = sizeof(FFT_PeakTypeDef);
+            memcpy(data, peaks, count * sizeof(FFT_PeakTypeDef));   // 幅度谱已用完, 峰值存回缓冲区待发送
+        }
+        post_cycles = GetCycleCount() - start;
+    
+        /* 信息帧负载, 多字节字段按小端(本机字节序) */
+        rate = Capture_GetRate(&temp_capture);
+        spectrum_info[0] = spectrum_peaks ? SPECTRUM_TYPE_PEAKS : SPECTRUM_TYPE_FULL;
+        spectrum_info[1] = spectrum_log2n;
+        memcpy(spectrum_info + 2, &rate, 4);
+        memcpy(spectrum_info + 6, &fft_cycles, 4);
+        memcpy(spectrum_info + 10, &post_cycles, 4);
+        memcpy(spectrum_info + 14, &count, 2);
+    
+        spectrum_data = (uint8_t *)data;
+        spectrum_count = count;
+        spectrum_index = 0;
+        spectrum_state = SPECTRUM_READY;
+    }
+    
+    /* 每次主循环发送几帧; 发送队列放不下整帧时留到下一次, 不丢数据 */
+    while ((spectrum_state == SPECTRUM_READY || spectrum_state == SPECTRUM_SENDING) &&
+           frames > 0 && USART_GetTxFree() >= TELEMETRY_ENCODED_MAX)
+    {
+        if (spectrum_state == SPECTRUM_READY)
+        {
+            Telemetry_Send(TELEMETRY_TYPE_SPECTRUM, 0, spectrum_time, spectrum_info, sizeof(spectrum_info));
+            spectrum_state = SPECTRUM_SENDING;
+        }
+        else
+        {
+            count = spectrum_count - spectrum_index;
+            if (count > (TELEMETRY_PAYLOAD_MAX - 2) / spectrum_item)
+                count = (TELEMETRY_PAYLOAD_MAX - 2) / spectrum_item;
+            memcpy(payload, &spectrum_index, 2);
+            memcpy(payload + 2, spectrum_data + spectrum_index * spectrum_item, count * spectrum_item);
+            Telemetry_Send(TELEMETRY_TYPE_SPECTRUM_DATA, 0, spectrum_time, payload, 2 + count * spectrum_item);
+            spectrum_index += count;
+        }
+        frames--;
+    
+        if (spectrum_state == SPECTRUM_SENDING && spectrum_index >= spectrum_count)
+        {
+            Capture_Release(&temp_capture);
+            spectrum_state = SPECTRUM_IDLE;
+        }
+    }
+}
+
+/* 快照完成回调, 在ADC1_2中断中调用 */
+static void Snapshot_Done(uint8_t channel, uint16_t value)
+{
+    snapshot_channel = channel;
+    snapshot_value = value;
+    snapshot_ready = 1;
+}
+
+/* 发送快照结果及请求到完成的延迟 */
+void Send_Snapshot(void)
+{
+    char response[64] = {0};
+    char value_buffer[12] = {0};
+    uint32_t latency;
+    
+    if (!snapshot_ready)
+        return;
+    snapshot_ready = 0;
+    
+    latency = ADC_GetSnapshotLatency(0);
+    Format_Temperature(value_buffer, ADC_ConvertTemperature(snapshot_value, 12));
+    sprintf(response, "Snapshot CH%u: %u (%s°C), %lu cyc\r\n", (unsigned int)snapshot_channel,
+            (unsigned int)snapshot_value, value_buffer, (unsigned long)latency);
+    USART_SendString(USART1, response);
+}
+
+/* 每TEMP_RECAL_INTERVAL_MS请求一次ADC后台校准, 完成后报告缺失帧数 */
+void Process_Recal(void)
+{
+    static uint32_t last_request = 0;
+    static uint32_t last_count = 0;
+    char response[48] = {0};
+    uint32_t count;
+    uint16_t gap;
+    
+    if (GetSysTime_ms() - last_request >= TEMP_RECAL_INTERVAL_MS)
+    {
+        last_request = GetSysTime_ms();
+        ADC_Recalibrate();
+    }
+    
+    count = ADC_GetRecalCount(&gap);
+    if (count != last_count)
+    {
+        last_count = count;
+        sprintf(response, "Recal #%lu: gap %u frames\r\n", (unsigned long)count, (unsigned int)gap);
+        USART_SendString(USART1, response);
+        Log_Event(EVENT_RECAL, gap);
+    }
+}
+
+/* ADC数据块处理函数, 在DMA中断中调用 */
+static void Process_ADC_Block(const ADC_BlockTypeDef *block)
+{
+    uint16_t ovs_value;
+    uint8_t valid = 0;
+    uint8_t i;
+    
+    /* 后台校准造成的采样间断: 捕获窗口和抽取窗口不跨越间断 */
+    if (block->gap)
+    {
+        Capture_MarkGap(&temp_capture);
+        Oversample_Reset(&temp_oversample);
+    }
+    
+    /* 全速率波形捕获 */
+    Capture_PushBlock(&temp_capture, block->data, block->length, block->channels);
+    
+    /* 各通道健康监测 */
+    for (i = 0; i < block->channels; i++)
+    {
+        Health_PushBlock(&sensor_health[i], block->data + i, block->length, block->channels);
+    }
+    
+    /* 冗余探头逐帧卡尔曼融合, 故障探头剔除; 只配置一个探头时原样通过, 不增加延迟 */
+    for (i = 0; i < FUSION_PROBE_COUNT; i++)
+    {
+        if (Health_GetFaults(&sensor_health[fusion_channels[i]]) == HEALTH_FAULT_NONE)
+            valid |= 1u << i;
+    }
+    Fusion_PushBlock(&temp_fusion, block->data, block->length, block->channels, valid, fused_block);
+    
+    /* 全速率融合估计送入过采样抽取器, 工频同步积分 */
+    Oversample_PushBlock(&temp_oversample, fused_block, block->length, 1);
+    
+    /* 抽取输出经滤波链去除尖峰噪声 */
+    if (Oversample_GetOutput(&temp_oversample, &ovs_value))
+    {
+        temp_filtered = (uint16_t)Filter_ChainProcess(&temp_filter, ovs_value);
+        temp_sample_time = ADC_GetFrameTime(block, block->length - 1 - temp_oversample.count);
+        temp_lead_counts = Filter_Process(&temp_lead, temp_filtered);
+        Adapt_Push(&temp_adapt, ovs_value, temp_filtered);
+        temp_filtered_ready = 1;
+    }
+}
 
 void Process_Key(void)
 {
@@ -176,11 +1362,14 @@ void Process_Key(void)
         {
             /* 循环切换温度阈值 */
             temp_threshold_index = (temp_threshold_index + 1) % 3;
-            current_threshold = temp_thresholds[temp_threshold_index];
+            Set_Threshold(temp_thresholds[temp_threshold_index]);
+            Log_Event(EVENT_THRESHOLD, current_threshold);
             
             /* 通过串口发送新的阈值 */
             char threshold_buffer[30];
-            sprintf(threshold_buffer, "New Threshold: %.1f°C\r\n", current_threshold);
+            char value_buffer[12];
+            Format_Temperature(value_buffer, current_threshold);
+            sprintf(threshold_buffer, "New Threshold: %s°C\r\n", value_buffer);
             USART_SendString(USART1, threshold_buffer);
             
             /* 标记此次按键已处理 */
@@ -215,9 +1404,17 @@ void EXTI9_5_IRQHandler(void)
         /* 更严格的时间检测，防止频繁触发 */
         if(current_time - last_trigger_time > 200) // 增加到200ms的防抖时间
         {
-            /* 只设置标志，不读取按键状态（因为已经确认是下降沿触发了） */
-            extern uint8_t key_pressed_flag;
-            key_pressed_flag = 1;
+            /* 外部触发捕获布防时, 按键用作捕获触发, 不切换阈值 */
+            if (Capture_GetState(&temp_capture) == CAPTURE_ARMED && temp_capture.mode == CAPTURE_TRIG_EXTERNAL)
+            {
+                Capture_Trigger(&temp_capture);
+            }
+            else
+            {
+                /* 只设置标志，不读取按键状态（因为已经确认是下降沿触发了） */
+                extern uint8_t key_pressed_flag;
+                key_pressed_flag = 1;
+            }
             last_trigger_time = current_time;
         }
         
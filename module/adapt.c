@@ -0,0 +1,166 @@
+/*
+ * 文件名: adapt.c
+ * 描述: 自适应采样率模块
+ * 功能: 根据滤波输出的变化率和噪声方差调整ADC触发率: 信号平稳时逐档降低以节省CPU和串口带宽,
+ *       变化快或噪声增大时立即升档; 升降档阈值分开并要求持续安静时间, 避免来回振荡
+ */
+
+#include "stm32f10x.h"
+#include "adapt.h"
+
+/* 各档位采样率倍率(/8) */
+static const uint8_t adapt_rate_mult[ADAPT_LEVELS] = {1, 2, 4, 8, 16};
+
+/**
+ * @brief  每次评估合并的输出数
+ * @note   高于ADAPT_LEVEL_SYNC的档位一个输出不足一个工频周期, 单个输出带有工频纹波,
+ *         合并一个整周期内的输出后纹波抵消, 变化量和方差才反映温度本身
+ * @param  level: 档位
+ * @retval 输出数
+ */
+static uint8_t Adapt_GroupSize(uint8_t level)
+{
+    return (level > ADAPT_LEVEL_SYNC) ? (uint8_t)(1 << (level - ADAPT_LEVEL_SYNC)) : 1;
+}
+
+/**
+ * @brief  初始化控制器
+ * @param  adapt: 控制器
+ * @param  enabled: 1 - 自适应, 0 - 固定默认档位
+ * @retval 无
+ */
+void Adapt_Init(Adapt_TypeDef *adapt, uint8_t enabled)
+{
+    adapt->enabled = enabled;
+    adapt->level = ADAPT_LEVEL_DEFAULT;
+    adapt->target = ADAPT_LEVEL_DEFAULT;
+    adapt->period_us = 0;
+    adapt->primed = 0;
+    adapt->raw_sum = 0;
+    adapt->filtered_sum = 0;
+    adapt->group = 0;
+    adapt->delta = 0;
+    adapt->variance = 0;
+    adapt->quiet_us = 0;
+}
+
+/**
+ * @brief  输入一个输出样本
+ * @note   在ADC数据块回调(DMA中断)中每个过采样输出调用一次; 只更新目标档位,
+ *         采样率由主循环调用ADC_SetSampleRate生效后再调用Adapt_SetLevel;
+ *         升档立即进行, 降档须满足降档后的预计变化量和方差都足够小并持续ADAPT_DWELL_MS.
+ *         高于ADAPT_LEVEL_SYNC的档位按整工频周期合并输出后评估
+ * @param  adapt: 控制器
+ * @param  raw: 过采样输出(未滤波)
+ * @param  filtered: 滤波输出
+ * @retval 无
+ */
+void Adapt_Push(Adapt_TypeDef *adapt, uint16_t raw, uint16_t filtered)
+{
+    uint8_t n = Adapt_GroupSize(adapt->level);
+    int32_t d, e;
+    
+    /* 合并整工频周期内的输出 */
+    adapt->raw_sum += raw;
+    adapt->filtered_sum += filtered;
+    if (++adapt->group < n)
+        return;
+    raw = (uint16_t)(adapt->raw_sum / n);
+    filtered = (uint16_t)(adapt->filtered_sum / n);
+    adapt->raw_sum = 0;
+    adapt->filtered_sum = 0;
+    adapt->group = 0;
+    
+    if (!adapt->primed)
+    {
+        adapt->prev = filtered;
+        adapt->primed = 1;
+        return;
+    }
+    
+    /* 变化量和噪声方差的指数平均 */
+    d = (int32_t)filtered - adapt->prev;
+    if (d < 0)
+        d = -d;
+    adapt->prev = filtered;
+    adapt->delta += ((int32_t)(d << 4) - (int32_t)adapt->delta) >> ADAPT_EWMA_SHIFT;
+    
+    e = (int32_t)raw - filtered;
+    if (e > ADAPT_VAR_CLAMP)
+        e = ADAPT_VAR_CLAMP;
+    if (e < -ADAPT_VAR_CLAMP)
+        e = -ADAPT_VAR_CLAMP;
+    adapt->variance += (e * e - (int32_t)adapt->variance) >> ADAPT_EWMA_SHIFT;
+    
+    /* 固定档位或上次调整尚未生效 */
+    if (!adapt->enabled || adapt->target != adapt->level)
+        return;
+    
+    if (adapt->level + 1 < ADAPT_LEVELS &&
+        (adapt->delta > (ADAPT_DELTA_UP << 4) || adapt->variance > ADAPT_VAR_UP))
+    {
+        adapt->target = adapt->level + 1;
+        adapt->quiet_us = 0;
+    }
+    else if (adapt->level > 0 && adapt->variance < ADAPT_VAR_DOWN &&
+             adapt->delta * (adapt->level > ADAPT_LEVEL_SYNC ? 1 : 2) < (ADAPT_DELTA_DOWN << 4))
+    {
+        /* 降档后评估间隔加倍(ADAPT_LEVEL_SYNC以上不变), 变化量预计也加倍 */
+        adapt->quiet_us += adapt->period_us;
+        if (adapt->quiet_us >= ADAPT_DWELL_MS * 1000u)
+        {
+            adapt->target = adapt->level - 1;
+            adapt->quiet_us = 0;
+        }
+    }
+    else
+    {
+        adapt->quiet_us = 0;
+    }
+}
+
+/**
+ * @brief  档位对应的采样率
+ * @param  level: 档位, 0 ~ ADAPT_LEVELS - 1
+ * @param  sync_rate: 工频同步采样率(Hz), 即每个工频周期一个输出时的采样率
+ * @retval 采样率(Hz)
+ */
+uint32_t Adapt_GetRate(uint8_t level, uint32_t sync_rate)
+{
+    if (level >= ADAPT_LEVELS)
+        level = ADAPT_LEVEL_DEFAULT;
+    
+    return sync_rate * adapt_rate_mult[level] / 8;
+}
+
+/**
+ * @brief  档位已生效
+ * @note   在主循环中调用, 须屏蔽DMA中断; 变化量均值按新评估间隔折算,
+ *         ADAPT_LEVEL_SYNC以上的档位评估间隔均为一个工频周期, 不折算
+ * @param  adapt: 控制器
+ * @param  level: 已生效的档位
+ * @param  period_us: 新的输出周期(us)
+ * @retval 无
+ */
+void Adapt_SetLevel(Adapt_TypeDef *adapt, uint8_t level, uint32_t period_us)
+{
+    uint8_t from, to;
+    
+    if (level >= ADAPT_LEVELS)
+        level = ADAPT_LEVEL_DEFAULT;
+    
+    from = (adapt->level > ADAPT_LEVEL_SYNC) ? ADAPT_LEVEL_SYNC : adapt->level;
+    to = (level > ADAPT_LEVEL_SYNC) ? ADAPT_LEVEL_SYNC : level;
+    if (adapt->primed && to > from)
+        adapt->delta >>= to - from;
+    else if (adapt->primed && to < from)
+        adapt->delta <<= from - to;
+    
+    adapt->level = level;
+    adapt->target = level;
+    adapt->period_us = period_us * Adapt_GroupSize(level);
+    adapt->raw_sum = 0;
+    adapt->filtered_sum = 0;
+    adapt->group = 0;
+    adapt->quiet_us = 0;
+}
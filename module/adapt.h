@@ -0,0 +1,50 @@
+/*
+ * 文件名: adapt.h
+ * 描述: 自适应采样率模块头文件
+ * 功能: 声明按信号活动度调整采样率的控制器相关类型和函数
+ */
+
+#ifndef __ADAPT_H
+#define __ADAPT_H
+
+#include "stm32f10x.h"
+
+/* 采样率档位: 采样率 = 工频同步采样率 * 倍率 / 8, 过采样倍率不变
+ * 档位0~3每个输出积分8/4/2/1个工频周期, 保持工频抑制; 档位4每半个工频周期输出一次, 用于快速瞬变 */
+#define ADAPT_LEVELS            5           // 档位数
+#define ADAPT_LEVEL_DEFAULT     3           // 默认档位: 每个工频周期一个输出
+#define ADAPT_LEVEL_SYNC        3           // 每个工频周期一个输出的档位; 更高档位先把整周期内的输出合并再评估活动度
+
+/* 切换条件 (TEMP_OVS_BITS位计数, 1计数约0.005°C) */
+#define ADAPT_DELTA_UP          32          // 相邻输出变化量均值超过该值升档
+#define ADAPT_DELTA_DOWN        8           // 降档后预计变化量低于该值才允许降档
+#define ADAPT_VAR_UP            256         // 原始与滤波输出之差的方差超过该值升档
+#define ADAPT_VAR_DOWN          32          // 方差低于该值才允许降档
+#define ADAPT_VAR_CLAMP         4095        // 方差估计的单点差值限幅
+#define ADAPT_DWELL_MS          5000        // 持续安静该时长后降一档
+#define ADAPT_EWMA_SHIFT        2           // 均值/方差估计的平滑系数 1/2^n
+
+/* 自适应采样率控制器 */
+typedef struct
+{
+    uint8_t enabled;                // 1 - 自适应, 0 - 固定默认档位
+    uint8_t level;                  // 当前已生效档位
+    volatile uint8_t target;        // 控制器要求的档位, 由主循环生效
+    uint8_t primed;                 // 已记录第一个输出
+    uint16_t prev;                  // 上一个滤波输出
+    uint32_t delta;                 // 相邻输出变化量均值, Q4计数
+    uint32_t variance;              // 原始与滤波输出之差的方差, 计数^2
+    uint32_t raw_sum;               // 整工频周期内过采样输出之和
+    uint32_t filtered_sum;          // 整工频周期内滤波输出之和
+    uint8_t group;                  // 已累加的输出数
+    uint32_t period_us;             // 评估间隔(us), 不短于一个工频周期
+    uint32_t quiet_us;              // 已持续安静时间(us)
+} Adapt_TypeDef;
+
+/* 函数声明 */
+void Adapt_Init(Adapt_TypeDef *adapt, uint8_t enabled);    // 初始化控制器, 从默认档位开始
+void Adapt_Push(Adapt_TypeDef *adapt, uint16_t raw, uint16_t filtered);    // 输入一个输出样本, 更新活动度和目标档位
+uint32_t Adapt_GetRate(uint8_t level, uint32_t sync_rate);  // 档位对应的采样率(Hz)
+void Adapt_SetLevel(Adapt_TypeDef *adapt, uint8_t level, uint32_t period_us); // 档位已生效, 记录新的输出周期
+
+#endif /* __ADAPT_H */
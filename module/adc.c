@@ -1,43 +1,658 @@
-/* 
+/*
  * 描述: ADC模块，用于温度采集
- * 功能: 配置ADC，读取LM35传感器数据并转换为温度值
+ * 功能: 配置ADC，由TIM3定时触发扫描、DMA循环采集多路传感器数据并转换为温度值
  */
 
 #include "stm32f10x.h"
 #include "adc.h"
+#include "systick.h"
 
-/* ADC采样结果变量 */
-__IO uint16_t ADC_ConvertedValue = 0;
+/* ADC采样结果DMA环形缓冲区, 按帧交织存放: 帧内依次为各逻辑通道;
+   双ADC模式下DMA按32位搬运(低半字ADC1, 高半字ADC2), 故以字对齐 */
+static volatile union
+{
+    uint32_t word[ADC_DMA_BUF_SIZE / 2];
+    uint16_t half[ADC_DMA_BUF_SIZE];
+} adc_dma_buffer;
+
+/* 各采样时间对应的ADC时钟周期数 x2 (1.5 ~ 239.5) */
+static const uint16_t adc_sample_cycles_x2[8] = {3, 15, 27, 57, 83, 111, 143, 479};
+
+/* 内部通道注入组转换时间: 2 x (239.5 + 12.5) 个ADC周期, x2 */
+#define ADC_INTERNAL_CYCLES_X2  (2 * (479 + 25))
+#define ADC_TSTAB_US            1       // ADC上电稳定时间tSTAB(us)
+
+/* 默认通道: PA2上的LM35 */
+static const ADC_ChannelConfigTypeDef adc_default_channel =
+{
+    ADC_Channel_2, ADC_SampleTime_239Cycles5, ADC_CENTI_SCALE_Q16, 0, 3000
+};
+
+/* 扫描通道状态 */
+static ADC_ChannelConfigTypeDef adc_channels[ADC_MAX_CHANNELS];  // 扫描通道配置(按转换顺序)
+static uint16_t adc_threshold_counts[ADC_MAX_CHANNELS];         // 各通道阈值换算后的ADC值
+static uint32_t adc_scale_q16[ADC_MAX_CHANNELS];                // 各通道按实测VDDA修正后的每LSB物理量, Q16
+static uint8_t adc_pair_channels[ADC_MAX_CHANNELS]; // 双ADC模式下ADC2各序列位置的通道
+static uint8_t adc_channel_count = 0;               // ADC1扫描通道数
+static uint8_t adc_frame_width = 1;                 // 每帧逻辑通道数(双ADC模式为扫描通道数的2倍)
+static uint8_t adc_acq_mode = ADC_ACQ_INDEPENDENT;  // 采集模式
+static uint8_t adc2_enabled = 0;                    // ADC2已上电并校准
+static uint16_t adc_frames_per_block = ADC_BLOCK_SIZE;  // 每个数据块的帧数
+static uint16_t adc_dma_length = ADC_DMA_BUF_SIZE;  // DMA实际使用长度(半字数, 两个数据块)
+
+/* 数据块状态变量 */
+static ADC_BlockTypeDef adc_ready_block;            // 最新完成、等待主循环读取的数据块
+static volatile uint8_t adc_block_ready = 0;        // 数据块就绪标志
+static volatile uint32_t adc_block_seq = 0;         // 数据块序号
+static volatile uint32_t adc_overrun_count = 0;     // 数据块被覆盖计数
+static ADC_BlockCallback adc_half_cplt_callback = 0; // 半传输完成回调
+static ADC_BlockCallback adc_cplt_callback = 0;      // 全传输完成回调
+static uint32_t adc_sample_rate = 0;                // 定时器触发采样率(Hz)
+static uint32_t adc_frame_ticks = ADC_TRIG_TIM_CLK / ADC_SAMPLE_RATE_DEFAULT; // 帧间隔(TIM3时钟数)
+
+/* 内部通道(Vrefint/温度传感器)状态 */
+static volatile uint16_t adc_vdda_mv = ADC_VREF_MV;             // 实测VDDA(mV)
+static volatile uint32_t adc_temp_scale_q16 = ADC_CENTI_SCALE_Q16; // 实测VDDA下LM35每LSB温度, Q16
+static volatile int32_t adc_board_temp = 0;         // 芯片温度(0.01°C)
+static volatile uint16_t adc_ts_raw = 0;            // 温度传感器原始值
+static uint32_t adc_vrefint_filter = 0;             // Vrefint一阶低通滤波值, Q4
+static uint8_t adc_internal_divider = 0;            // 内部通道采样分频计数
+static uint8_t adc_internal_allowed = 0;            // 1 - 两帧间隙足以容纳注入转换
+
+/* 模拟看门狗状态 */
+static volatile uint8_t adc_wd_alarm = 0;           // 看门狗报警状态
+static uint16_t adc_wd_trip = 4095;                 // 报警阈值(ADC值), 超过即报警
+static uint16_t adc_wd_release = 0;                 // 解除阈值(ADC值), 低于即解除
+static volatile uint8_t adc_wd_armed = 0;           // 1 - 看门狗中断已使能, 触发后清零待主循环重新使能
+static ADC_WatchdogCallback adc_wd_callback = 0;    // 报警状态变化回调
+
+/* 注入组任务 */
+#define ADC_INJ_IDLE            0   // 空闲
+#define ADC_INJ_INTERNAL        1   // 内部通道后台采样
+#define ADC_INJ_SNAPSHOT        2   // 快照读取
+#define ADC_INJ_RECAL           3   // 后台校准占用ADC, 注入组暂停
+
+/* 快照请求 */
+typedef struct
+{
+    uint8_t channel;                // ADC通道号
+    ADC_SnapshotCallback callback;  // 完成回调
+    uint32_t start;                 // 请求时刻CPU周期计数
+} ADC_SnapshotTypeDef;
+
+static volatile uint8_t adc_inj_job = ADC_INJ_IDLE; // 注入组当前任务
+static volatile uint8_t adc_internal_result = 0;    // 内部通道有新结果待换算
+static uint16_t adc_vref_raw = 0;                   // 最近一次Vrefint原始值
+static uint16_t adc_ts_new_raw = 0;                 // 最近一次温度传感器原始值(待换算)
+static ADC_SnapshotTypeDef adc_snapshot_queue[ADC_SNAPSHOT_QUEUE_SIZE]; // 快照请求队列
+static volatile uint8_t adc_snapshot_head = 0;      // 队列写入位置
+static volatile uint8_t adc_snapshot_tail = 0;      // 队列读出位置(队首为正在转换的快照)
+static volatile uint32_t adc_snapshot_latency = 0;  // 最近一次快照请求到回调的CPU周期数
+static volatile uint32_t adc_snapshot_latency_max = 0; // 快照延迟峰值
+
+/* 后台校准状态 */
+#define ADC_RECAL_IDLE          0   // 空闲
+#define ADC_RECAL_PENDING       1   // 已请求, 等待DMA缓冲区回绕
+#define ADC_RECAL_POWER_OFF     2   // ADC已断电(ADON=0), 等待至少两个ADC时钟
+#define ADC_RECAL_POWER_ON      3   // ADC已上电, 等待tSTAB稳定
+#define ADC_RECAL_RESET         4   // 等待校准寄存器复位完成
+#define ADC_RECAL_CALIB         5   // 等待校准完成
+
+static volatile uint8_t adc_recal_state = ADC_RECAL_IDLE;   // 后台校准状态
+static uint16_t adc_recal_frames = 0;               // 本次暂停已跳过的触发数(帧数)
+static volatile uint16_t adc_gap_pending = 0;       // 待标记到下一个数据块的缺失帧数
+static volatile uint16_t adc_recal_last_gap = 0;    // 最近一次校准的缺失帧数
+static volatile uint32_t adc_recal_count = 0;       // 已完成的后台校准次数
 
 /**
- * @brief  配置ADC模块
+ * @brief  配置采样触发定时器TIM3
+ * @note   TIM3更新事件作为TRGO触发ADC1规则组转换
  * @param  无
  * @retval 无
  */
-void ADC_Config(void)
+static void ADC_TriggerTimerConfig(void)
 {
-    ADC_InitTypeDef ADC_InitStructure;
-    GPIO_InitTypeDef GPIO_InitStructure;
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    
+    /* 使能TIM3时钟 */
+    RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
+    
+    /* 时基先按最大周期配置, 实际周期由ADC_SetSampleRate设定 */
+    TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+    TIM_TimeBaseStructure.TIM_Prescaler = 0;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseInit(TIM3, &TIM_TimeBaseStructure);
+    
+    /* 更新事件输出到TRGO, ARR预装载保证改变采样率时无毛刺 */
+    TIM_SelectOutputTrigger(TIM3, TIM_TRGOSource_Update);
+    TIM_ARRPreloadConfig(TIM3, ENABLE);
+}
+
+/**
+ * @brief  计算一帧扫描所需的ADC时钟周期数
+ * @param  无
+ * @retval ADC时钟周期数 x2
+ */
+static uint32_t ADC_FrameCycles_x2(void)
+{
+    uint32_t cycles = 0;
+    uint8_t i;
     
-    /* 使能ADC1和GPIOA时钟 */
-    RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1 | RCC_APB2Periph_GPIOA, ENABLE);
+    /* 每通道 = 采样时间 + 12.5周期转换时间 */
+    for (i = 0; i < adc_channel_count; i++)
+    {
+        cycles += adc_sample_cycles_x2[adc_channels[i].sample_time] + 25;
+    }
+    
+    return cycles;
+}
+
+/**
+ * @brief  将ADC通道对应的引脚配置为模拟输入
+ * @param  channel: ADC通道号 ADC_Channel_0 ~ ADC_Channel_9
+ * @retval 无
+ */
+static void ADC_PinConfig(uint8_t channel)
+{
+    GPIO_InitTypeDef GPIO_InitStructure;
     
-    /* 配置PA2为模拟输入 - LM35连接到此引脚 */
-    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_2;
     GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AIN;
-    GPIO_Init(GPIOA, &GPIO_InitStructure);
     
-    /* ADC1配置 */
-    ADC_InitStructure.ADC_Mode = ADC_Mode_Independent;
-    ADC_InitStructure.ADC_ScanConvMode = DISABLE;
-    ADC_InitStructure.ADC_ContinuousConvMode = ENABLE;
-    ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+    /* 通道0~7对应PA0~PA7, 通道8~9对应PB0~PB1 */
+    if (channel <= ADC_Channel_7)
+    {
+        GPIO_InitStructure.GPIO_Pin = (uint16_t)(1u << channel);
+        GPIO_Init(GPIOA, &GPIO_InitStructure);
+    }
+    else
+    {
+        GPIO_InitStructure.GPIO_Pin = (uint16_t)(1u << (channel - ADC_Channel_8));
+        GPIO_Init(GPIOB, &GPIO_InitStructure);
+    }
+}
+
+/**
+ * @brief  检查通道能否作为扫描输入
+ * @note   扫描通道的引脚会被改为模拟输入, 用作LED/PWM输出的PA0/PA1不可使用
+ * @param  channel: ADC通道号
+ * @retval 1 - 可用, 0 - 超出范围或引脚已占用
+ */
+static uint8_t ADC_ScanChannelValid(uint8_t channel)
+{
+    return (channel <= ADC_Channel_9 && (ADC_CHANNEL_RESERVED_MASK & (1u << channel)) == 0);
+}
+
+/**
+ * @brief  配置DMA1通道1
+ * @note   调用前须保证DMA已停止
+ * @param  word_transfer: 1 - 32位传输(双ADC模式), 0 - 16位传输
+ * @retval 无
+ */
+static void ADC_DMAConfig(uint8_t word_transfer)
+{
+    DMA_InitTypeDef DMA_InitStructure;
+    
+    /* DMA1通道1配置: ADC1->DR 到 adc_dma_buffer, 循环模式 */
+    DMA_DeInit(DMA1_Channel1);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&ADC1->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)adc_dma_buffer.word;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = word_transfer ? adc_dma_length / 2 : adc_dma_length;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = word_transfer ? DMA_PeripheralDataSize_Word : DMA_PeripheralDataSize_HalfWord;
+    DMA_InitStructure.DMA_MemoryDataSize = word_transfer ? DMA_MemoryDataSize_Word : DMA_MemoryDataSize_HalfWord;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel1, &DMA_InitStructure);
+    
+    /* 使能半传输和全传输中断 */
+    DMA_ITConfig(DMA1_Channel1, DMA_IT_HT | DMA_IT_TC, ENABLE);
+}
+
+/**
+ * @brief  应用扫描通道和采集模式配置
+ * @note   配置引脚、规则序列和DMA长度, 调用前须保证ADC与DMA已停止
+ * @param  无
+ * @retval 无
+ */
+static void ADC_ApplyChannels(void)
+{
+    ADC_InitTypeDef ADC_InitStructure;
+    uint8_t dual = (adc_acq_mode != ADC_ACQ_INDEPENDENT);
+    uint8_t sample_time;
+    uint8_t i;
+    
+    for (i = 0; i < adc_channel_count; i++)
+    {
+        /* 快速交替模式下采样时间须小于7个ADC周期 */
+        sample_time = (adc_acq_mode == ADC_ACQ_INTERLEAVED) ? ADC_SampleTime_1Cycles5 : adc_channels[i].sample_time;
+    
+        /* 规则序列第i+1个转换, 双ADC模式下ADC2在同一序列位置转换配对通道 */
+        ADC_PinConfig(adc_channels[i].channel);
+        ADC_RegularChannelConfig(ADC1, adc_channels[i].channel, i + 1, sample_time);
+        if (dual)
+        {
+            ADC_PinConfig(adc_pair_channels[i]);
+            ADC_RegularChannelConfig(ADC2, adc_pair_channels[i], i + 1, sample_time);
+        }
+    }
+    
+    /* ADC1配置: 一次触发转换整个序列, 注入组含两个内部通道, 故始终开启扫描;
+       快速交替模式由软件启动后连续转换, 不使用定时器触发 */
+    if (adc_acq_mode == ADC_ACQ_SIMULT)
+        ADC_InitStructure.ADC_Mode = ADC_Mode_RegSimult;
+    else if (adc_acq_mode == ADC_ACQ_INTERLEAVED)
+        ADC_InitStructure.ADC_Mode = ADC_Mode_FastInterl;
+    else
+        ADC_InitStructure.ADC_Mode = ADC_Mode_Independent;
+    ADC_InitStructure.ADC_ScanConvMode = ENABLE;
+    ADC_InitStructure.ADC_ContinuousConvMode = (adc_acq_mode == ADC_ACQ_INTERLEAVED) ? ENABLE : DISABLE;
+    ADC_InitStructure.ADC_ExternalTrigConv = (adc_acq_mode == ADC_ACQ_INTERLEAVED) ?
+                                             ADC_ExternalTrigConv_None : ADC_ExternalTrigConv_T3_TRGO;
     ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;
-    ADC_InitStructure.ADC_NbrOfChannel = 1;
+    ADC_InitStructure.ADC_NbrOfChannel = adc_channel_count;
     ADC_Init(ADC1, &ADC_InitStructure);
     
-    /* 配置ADC1通道2为55.5个采样周期，采样率约50Hz */
-    ADC_RegularChannelConfig(ADC1, ADC_Channel_2, 1, ADC_SampleTime_55Cycles5);
+    /* ADC2作为从ADC, 由ADC1启动 */
+    if (adc2_enabled)
+    {
+        ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+        ADC_Init(ADC2, &ADC_InitStructure);
+    }
+    
+    /* 模拟看门狗监视第一个通道(主探头) */
+    ADC_AnalogWatchdogSingleChannelConfig(ADC1, adc_channels[0].channel);
+    
+    /* DMA长度取整数帧, 半传输和全传输恰好落在帧边界 */
+    adc_frame_width = dual ? adc_channel_count * 2 : adc_channel_count;
+    adc_frames_per_block = ADC_BLOCK_SIZE / adc_frame_width;
+    adc_dma_length = adc_frames_per_block * adc_frame_width * 2;
+    ADC_DMAConfig(dual);
+    
+    adc_block_ready = 0;
+}
+
+/**
+ * @brief  快照通道的采样时间
+ * @note   采样时间寄存器按通道共用于规则组和注入组: 扫描中的通道沿用其配置, 不改变扫描;
+ *         内部温度传感器和Vrefint须长采样
+ * @param  channel: 通道号
+ * @retval 采样时间 ADC_SampleTime_xxx
+ */
+static uint8_t ADC_SnapshotSampleTime(uint8_t channel)
+{
+    uint8_t i;
+    
+    if (channel >= ADC_Channel_16)
+        return ADC_SNAPSHOT_INTERNAL_SAMPLE_TIME;
+    
+    for (i = 0; i < adc_channel_count; i++)
+    {
+        if (adc_channels[i].channel == channel)
+            return adc_channels[i].sample_time;
+    }
+    
+    return ADC_SNAPSHOT_SAMPLE_TIME;
+}
+
+/**
+ * @brief  启动队列中的下一个快照
+ * @note   调用前注入组须空闲且不会被ADC1_2中断打断
+ * @param  无
+ * @retval 无
+ */
+static void ADC_SnapshotNext(void)
+{
+    uint8_t channel;
+    
+    if (adc_snapshot_head == adc_snapshot_tail)
+        return;
+    
+    channel = adc_snapshot_queue[adc_snapshot_tail].channel;
+    ADC_InjectedSequencerLengthConfig(ADC1, 1);
+    ADC_InjectedChannelConfig(ADC1, channel, 1, ADC_SnapshotSampleTime(channel));
+    adc_inj_job = ADC_INJ_SNAPSHOT;
+    ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+}
+
+/**
+ * @brief  结束后台校准, 恢复规则组采集
+ * @note   重新使能DMA请求和外部触发, 下一次TIM3更新事件起继续转换;
+ *         暂停期间跳过的帧数记入下一个数据块的gap
+ * @param  无
+ * @retval 无
+ */
+static void ADC_RecalResume(void)
+{
+    TIM_ITConfig(TIM3, TIM_IT_Update, DISABLE);
+    ADC_DMACmd(ADC1, ENABLE);
+    ADC_ExternalTrigConvCmd(ADC1, ENABLE);
+    
+    adc_gap_pending += adc_recal_frames;
+    adc_recal_last_gap = adc_recal_frames;
+    adc_recal_count++;
+    adc_recal_state = ADC_RECAL_IDLE;
+    
+    /* 释放注入组并启动校准期间排队的快照 */
+    adc_inj_job = ADC_INJ_IDLE;
+    ADC_SnapshotNext();
+}
+
+/**
+ * @brief  在DMA缓冲区回绕处暂停采集并开始后台校准
+ * @note   在全传输中断中调用, 此时最后一帧已写入、下一帧尚未触发.
+ *         先关外部触发再检查: DMA计数未回到满长度、有转换结果未被取走(EOC), 或距TIM3最近一次
+ *         更新不足一帧转换时间(中断响应较晚, 下一帧已触发), 说明下一帧已开始, 恢复触发推迟到
+ *         下一次回绕, 保证校准不打断转换. STRT每帧都会置位, 不能作为判据, 仅在此之后清除.
+ *         注入组忙时同样推迟. 手册要求校准前ADC断电至少两个ADC时钟, 故先断电, 之后的
+ *         上电、复位校准、校准各步由TIM3更新中断逐帧推进, 无忙等
+ * @param  无
+ * @retval 无
+ */
+static void ADC_RecalStart(void)
+{
+    uint16_t full = (adc_acq_mode == ADC_ACQ_INDEPENDENT) ? adc_dma_length : adc_dma_length / 2;
+    uint32_t elapsed;
+    
+    if (adc_inj_job != ADC_INJ_IDLE)
+        return;
+    
+    ADC_ExternalTrigConvCmd(ADC1, DISABLE);
+    elapsed = (uint32_t)TIM3->CNT * ((uint32_t)TIM3->PSC + 1);
+    if (DMA_GetCurrDataCounter(DMA1_Channel1) != full || ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC) != RESET ||
+        elapsed < ADC_FrameCycles_x2() * (ADC_TRIG_TIM_CLK / ADC_ADCCLK / 2))
+    {
+        ADC_ExternalTrigConvCmd(ADC1, ENABLE);
+        return;
+    }
+    ADC_ClearFlag(ADC1, ADC_FLAG_STRT);
+    
+    /* 校准期间ADC_DR输出校准码, 关闭DMA请求避免写入缓冲区 */
+    adc_inj_job = ADC_INJ_RECAL;
+    ADC_DMACmd(ADC1, DISABLE);
+    ADC_Cmd(ADC1, DISABLE);
+    if (adc2_enabled)
+        ADC_Cmd(ADC2, DISABLE);
+    
+    /* TIM3继续运行, 每个更新事件即一个缺失帧; 帧间隔远大于两个ADC时钟和tSTAB(1us) */
+    adc_recal_frames = 0;
+    adc_recal_state = ADC_RECAL_POWER_OFF;
+    TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
+    TIM_ITConfig(TIM3, TIM_IT_Update, ENABLE);
+}
+
+/**
+ * @brief  中止后台校准
+ * @note   配置变更前调用(采集定时器已停止). 已断电则重新上电并阻塞完成校准,
+ *         校准已开始则等待其结束(约7us, 配置变更路径本身即为阻塞操作),
+ *         恢复DMA请求和外部触发; 不记录缺失帧
+ * @param  无
+ * @retval 无
+ */
+static void ADC_RecalAbort(void)
+{
+    TIM_ITConfig(TIM3, TIM_IT_Update, DISABLE);
+    
+    if (adc_recal_state == ADC_RECAL_POWER_OFF)
+    {
+        /* ADON由0置1只唤醒, 不启动转换 */
+        ADC_Cmd(ADC1, ENABLE);
+        if (adc2_enabled)
+            ADC_Cmd(ADC2, ENABLE);
+        adc_recal_state = ADC_RECAL_POWER_ON;
+    }
+    if (adc_recal_state == ADC_RECAL_POWER_ON)
+    {
+        Delay_us(ADC_TSTAB_US);
+        ADC_ResetCalibration(ADC1);
+        if (adc2_enabled)
+            ADC_ResetCalibration(ADC2);
+        adc_recal_state = ADC_RECAL_RESET;
+    }
+    if (adc_recal_state == ADC_RECAL_RESET)
+    {
+        while (ADC_GetResetCalibrationStatus(ADC1));
+        ADC_StartCalibration(ADC1);
+        if (adc2_enabled)
+        {
+            while (ADC_GetResetCalibrationStatus(ADC2));
+            ADC_StartCalibration(ADC2);
+        }
+        adc_recal_state = ADC_RECAL_CALIB;
+    }
+    if (adc_recal_state == ADC_RECAL_CALIB)
+    {
+        while (ADC_GetCalibrationStatus(ADC1));
+        if (adc2_enabled)
+            while (ADC_GetCalibrationStatus(ADC2));
+        
+        ADC_DMACmd(ADC1, ENABLE);
+        ADC_ExternalTrigConvCmd(ADC1, ENABLE);
+        adc_inj_job = ADC_INJ_IDLE;
+        ADC_SnapshotNext();
+    }
+    
+    adc_recal_state = ADC_RECAL_IDLE;
+}
+
+/**
+ * @brief  停止采集
+ * @note   停止触发源并等待正在进行的一帧转换完成
+ * @param  无
+ * @retval 无
+ */
+static void ADC_StopAcquisition(void)
+{
+    TIM_Cmd(TIM3, DISABLE);
+    ADC_RecalAbort();
+    
+    /* 交替模式为连续转换, 清除CONT后当前转换结束即停止 */
+    ADC1->CR2 &= ~ADC_CR2_CONT;
+    if (adc2_enabled)
+        ADC2->CR2 &= ~ADC_CR2_CONT;
+    
+    Delay_us(ADC_FrameCycles_x2() / (ADC_ADCCLK * 2 / 1000000) + 1);
+    DMA_Cmd(DMA1_Channel1, DISABLE);
+    DMA_ClearITPendingBit(DMA1_IT_GL1);
+}
+
+/**
+ * @brief  恢复采集
+ * @param  无
+ * @retval 无
+ */
+static void ADC_StartAcquisition(void)
+{
+    DMA_Cmd(DMA1_Channel1, ENABLE);
+    
+    if (adc_acq_mode == ADC_ACQ_INTERLEAVED)
+    {
+        /* 交替模式: 软件启动一次, 之后两ADC连续交替转换 */
+        ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+    }
+    else
+    {
+        /* 采样率按新配置重新限幅后启动触发定时器 */
+        ADC_SetSampleRate(adc_sample_rate);
+        TIM_Cmd(TIM3, ENABLE);
+    }
+}
+
+/**
+ * @brief  配置注入组公共部分
+ * @note   注入组由软件启动, 由内部通道后台采样和快照读取分时使用
+ * @param  无
+ * @retval 无
+ */
+static void ADC_InjectedConfig(void)
+{
+    ADC_TempSensorVrefintCmd(ENABLE);
+    ADC_ExternalTrigInjectedConvConfig(ADC1, ADC_ExternalTrigInjecConv_None);
+    ADC_ExternalTrigInjectedConvCmd(ADC1, ENABLE);
+}
+
+/**
+ * @brief  设置内部通道注入序列
+ * @note   注入组: 第1个Vrefint(通道17), 第2个温度传感器(通道16),
+ *         两者均要求采样时间不少于17.1us, 取239.5周期; 调用前注入组须空闲
+ * @param  无
+ * @retval 无
+ */
+static void ADC_InternalSequence(void)
+{
+    ADC_InjectedSequencerLengthConfig(ADC1, 2);
+    ADC_InjectedChannelConfig(ADC1, ADC_Channel_17, 1, ADC_SampleTime_239Cycles5);
+    ADC_InjectedChannelConfig(ADC1, ADC_Channel_16, 2, ADC_SampleTime_239Cycles5);
+}
+
+/**
+ * @brief  根据内部通道转换结果更新VDDA、换算系数和板温
+ * @note   VDDA = Vrefint * 4095 / Vrefint原始值; 变化超过ADC_VDDA_HYST_MV时
+ *         才重算换算系数和各通道阈值, 避免每次采样都做除法.
+ *         Vrefint取典型值ADC_VREFINT_MV, 未逐片校准, 其±3%偏差原样进入VDDA
+ *         和比例换算的各通道读数; 补偿只消除VDDA的漂移, 不提高绝对精度
+ * @param  vref_raw: Vrefint原始值
+ * @param  ts_raw: 温度传感器原始值
+ * @retval 无
+ */
+static void ADC_UpdateSupply(uint16_t vref_raw, uint16_t ts_raw)
+{
+    uint32_t vdda, uv;
+    uint8_t i;
+    
+    if (vref_raw == 0)
+        return;
+    
+    /* 一阶低通(系数1/16), 滤波值为16倍Vrefint原始值 */
+    if (adc_vrefint_filter == 0)
+        adc_vrefint_filter = (uint32_t)vref_raw << 4;
+    else
+        adc_vrefint_filter = adc_vrefint_filter - (adc_vrefint_filter >> 4) + vref_raw;
+    
+    vdda = (ADC_VREFINT_MV * 4095u * 16 + adc_vrefint_filter / 2) / adc_vrefint_filter;
+    if (vdda < ADC_VDDA_MIN_MV)
+        vdda = ADC_VDDA_MIN_MV;
+    if (vdda > ADC_VDDA_MAX_MV)
+        vdda = ADC_VDDA_MAX_MV;
+    
+    if (vdda + ADC_VDDA_HYST_MV <= (uint32_t)adc_vdda_mv || vdda >= (uint32_t)adc_vdda_mv + ADC_VDDA_HYST_MV)
+    {
+        adc_vdda_mv = (uint16_t)vdda;
+        adc_temp_scale_q16 = (uint32_t)((((uint64_t)vdda * 10 << 16) + 2047) / 4095);
+        for (i = 0; i < adc_channel_count; i++)
+        {
+            ADC_SetChannelThreshold(i, adc_channels[i].threshold);
+        }
+    }
+    
+    /* 板温 = 25 + (V25 - Vsense) / Avg_Slope */
+    uv = (uint32_t)(((uint64_t)ts_raw * adc_vdda_mv * 1000 + 2047) / 4095);
+    adc_ts_raw = ts_raw;
+    adc_board_temp = 2500 + ((int32_t)ADC_TS_V25_UV - (int32_t)uv) * 100 / ADC_TS_SLOPE_UV;
+}
+
+/**
+ * @brief  内部通道后台采样
+ * @note   在DMA中断中调用, 每ADC_INTERNAL_INTERVAL个数据块启动一次注入转换;
+ *         数据块完成时一帧刚转换完, 注入转换在下一次TIM3触发前结束, 不会推迟
+ *         规则组采样. 间隙不足、双ADC模式或快照占用注入组时跳过本次, 保持上次结果.
+ *         结果由JEOC中断取回, 换算留到此处执行, 保持ADC1_2中断短小
+ * @param  无
+ * @retval 无
+ */
+static void ADC_InternalSample(void)
+{
+    /* 处理上次取回的结果 */
+    if (adc_internal_result)
+    {
+        adc_internal_result = 0;
+        ADC_UpdateSupply(adc_vref_raw, adc_ts_new_raw);
+    }
+    
+    if (adc_acq_mode != ADC_ACQ_INDEPENDENT)
+        return;
+    if (++adc_internal_divider < ADC_INTERNAL_INTERVAL)
+        return;
+    adc_internal_divider = 0;
+    
+    /* 紧接帧结束启动注入转换 */
+    if (adc_internal_allowed && adc_inj_job == ADC_INJ_IDLE)
+    {
+        ADC_InternalSequence();
+        adc_inj_job = ADC_INJ_INTERNAL;
+        ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+    }
+}
+
+/**
+ * @brief  按当前报警状态设置看门狗窗口
+ * @note   正常状态窗口为[0, trip], 超过即触发; 报警状态窗口为[release, 4095],
+ *         低于即触发. 窗口随状态切换, 值停留在一侧时不会反复进中断
+ * @param  无
+ * @retval 无
+ */
+static void ADC_WatchdogApply(void)
+{
+    if (adc_wd_alarm)
+        ADC_AnalogWatchdogThresholdsConfig(ADC1, 4095, adc_wd_release);
+    else
+        ADC_AnalogWatchdogThresholdsConfig(ADC1, adc_wd_trip, 0);
+}
+
+/**
+ * @brief  配置ADC模块
+ * @note   ADC1由TIM3 TRGO触发扫描转换, DMA1通道1循环搬运到adc_dma_buffer,
+ *         默认只扫描PA2(LM35)一个通道; 注入组在后台采样Vrefint和温度传感器
+ * @param  无
+ * @retval 无
+ */
+void ADC_Config(void)
+{
+    NVIC_InitTypeDef NVIC_InitStructure;
+    
+    /* ADC时钟 = PCLK2/6 = 12MHz (不得超过14MHz) */
+    RCC_ADCCLKConfig(RCC_PCLK2_Div6);
+    
+    /* 使能ADC1、GPIOA、GPIOB和DMA1时钟 */
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1 | RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+    
+    /* 配置DMA1通道1中断, 抢占优先级1(分组4, 见uesr_SystemInit) */
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel1_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    
+    /* 配置ADC1_2中断(模拟看门狗), 抢占优先级最高, 可打断DMA中断中的数据块处理,
+     * 报警延迟与主循环和数据块处理负载无关 */
+    NVIC_InitStructure.NVIC_IRQChannel = ADC1_2_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    
+    /* 配置TIM3中断, 仅后台校准期间使能. 与DMA中断同为抢占优先级1, 互不抢占(共用校准状态),
+     * 同时挂起时DMA1通道1的中断号较小先执行; ADC1_2看门狗中断可抢占两者 */
+    NVIC_InitStructure.NVIC_IRQChannel = TIM3_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    
+    /* 默认通道配置, 239.5个采样周期: (239.5+12.5)/12MHz = 21us */
+    adc_channels[0] = adc_default_channel;
+    adc_channel_count = 1;
+    ADC_SetChannelThreshold(0, adc_default_channel.threshold);
+    ADC_ApplyChannels();
+    
+    DMA_Cmd(DMA1_Channel1, ENABLE);
+    
+    /* 使能ADC1的DMA请求 */
+    ADC_DMACmd(ADC1, ENABLE);
     
     /* 使能ADC1 */
     ADC_Cmd(ADC1, ENABLE);
@@ -48,42 +663,844 @@ void ADC_Config(void)
     ADC_StartCalibration(ADC1);
     while(ADC_GetCalibrationStatus(ADC1));
     
-    /* 启动ADC1转换 */
-    ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+    /* 内部通道首次转换(阻塞), 得到初始VDDA和板温 */
+    ADC_InjectedConfig();
+    ADC_InternalSequence();
+    Delay_us(10);   // 温度传感器和Vrefint上电稳定时间
+    ADC_SoftwareStartInjectedConvCmd(ADC1, ENABLE);
+    while(ADC_GetFlagStatus(ADC1, ADC_FLAG_JEOC) == RESET);
+    ADC_ClearFlag(ADC1, ADC_FLAG_JEOC);
+    ADC_UpdateSupply(ADC_GetInjectedConversionValue(ADC1, ADC_InjectedChannel_1),
+                     ADC_GetInjectedConversionValue(ADC1, ADC_InjectedChannel_2));
+    
+    /* 模拟看门狗: 默认阈值为满量程, 由ADC_WatchdogConfig设定 */
+    ADC_WatchdogApply();
+    ADC_AnalogWatchdogCmd(ADC1, ADC_AnalogWatchdog_SingleRegEnable);
+    ADC_ClearITPendingBit(ADC1, ADC_IT_AWD);
+    adc_wd_armed = 1;
+    ADC_ITConfig(ADC1, ADC_IT_AWD, ENABLE);
+    
+    /* 注入组转换完成中断: 取回内部通道和快照结果 */
+    ADC_ClearITPendingBit(ADC1, ADC_IT_JEOC);
+    ADC_ITConfig(ADC1, ADC_IT_JEOC, ENABLE);
+    
+    /* 使能外部触发, 由TIM3按固定周期启动转换 */
+    ADC_ExternalTrigConvCmd(ADC1, ENABLE);
+    
+    /* 配置并启动采样定时器 */
+    ADC_TriggerTimerConfig();
+    ADC_SetSampleRate(ADC_SAMPLE_RATE_DEFAULT);
+    TIM_Cmd(TIM3, ENABLE);
+}
+
+/**
+ * @brief  配置扫描通道列表
+ * @note   短暂停止采集, 等待当前帧转换结束后重建规则序列和DMA,
+ *         采样率按新配置重新限幅; 采集模式恢复为独立模式
+ * @param  channels: 通道配置数组, 按转换顺序排列
+ * @param  count: 通道数, 1 ~ ADC_MAX_CHANNELS
+ * @retval 0 - 成功, 1 - 参数无效(含通道0/1)
+ */
+uint8_t ADC_ScanConfig(const ADC_ChannelConfigTypeDef *channels, uint8_t count)
+{
+    uint8_t i;
+    
+    /* 检查参数 */
+    if (count == 0 || count > ADC_MAX_CHANNELS)
+        return 1;
+    for (i = 0; i < count; i++)
+    {
+        if (!ADC_ScanChannelValid(channels[i].channel) || channels[i].sample_time > ADC_SampleTime_239Cycles5)
+            return 1;
+    }
+    
+    /* 停止触发并等待正在进行的一帧转换完成 */
+    ADC_StopAcquisition();
+    
+    /* 更新通道配置 */
+    adc_acq_mode = ADC_ACQ_INDEPENDENT;
+    adc_channel_count = count;
+    for (i = 0; i < count; i++)
+    {
+        adc_channels[i] = channels[i];
+        ADC_SetChannelThreshold(i, channels[i].threshold);
+    }
+    ADC_ApplyChannels();
+    
+    /* 恢复采集 */
+    ADC_StartAcquisition();
+    
+    return 0;
+}
+
+/**
+ * @brief  设置采集模式
+ * @note   同步模式: ADC2与ADC1在同一时刻转换配对通道, 适合成对传感器;
+ *         快速交替模式: 两ADC对同一通道相隔7个ADC周期交替转换, 采样率翻倍,
+ *         仅支持单通道, 连续转换不受TIM3节拍控制, 用于突发/瞬态捕获,
+ *         每帧内ADC2的采样(逻辑通道1)先于ADC1(逻辑通道0)7个ADC周期;
+ *         双ADC模式下每帧逻辑通道 2i 为ADC1序列位置i, 2i+1 为ADC2序列位置i
+ * @param  mode: ADC_ACQ_INDEPENDENT / ADC_ACQ_SIMULT / ADC_ACQ_INTERLEAVED
+ * @param  pair_channels: 同步模式下ADC2各序列位置的通道, 其他模式可传0
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t ADC_SetAcquisitionMode(uint8_t mode, const uint8_t *pair_channels)
+{
+    uint8_t i;
+    
+    /* 检查参数 */
+    if (mode > ADC_ACQ_INTERLEAVED)
+        return 1;
+    if (mode == ADC_ACQ_INTERLEAVED && adc_channel_count != 1)
+        return 1;
+    if (mode == ADC_ACQ_SIMULT)
+    {
+        if (pair_channels == 0)
+            return 1;
+        for (i = 0; i < adc_channel_count; i++)
+        {
+            if (!ADC_ScanChannelValid(pair_channels[i]))
+                return 1;
+        }
+    }
+    
+    ADC_StopAcquisition();
+    
+    /* 首次进入双ADC模式时使能并校准ADC2 */
+    if (mode != ADC_ACQ_INDEPENDENT && !adc2_enabled)
+    {
+        RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC2, ENABLE);
+        ADC_Cmd(ADC2, ENABLE);
+        ADC_ResetCalibration(ADC2);
+        while(ADC_GetResetCalibrationStatus(ADC2));
+        ADC_StartCalibration(ADC2);
+        while(ADC_GetCalibrationStatus(ADC2));
+        ADC_ExternalTrigConvCmd(ADC2, ENABLE);
+        adc2_enabled = 1;
+    }
+    
+    /* 配对通道: 交替模式下ADC2与ADC1转换同一通道 */
+    for (i = 0; i < adc_channel_count; i++)
+    {
+        adc_pair_channels[i] = (mode == ADC_ACQ_SIMULT) ? pair_channels[i] : adc_channels[i].channel;
+    }
+    adc_acq_mode = mode;
+    
+    ADC_ApplyChannels();
+    ADC_StartAcquisition();
+    
+    return 0;
+}
+
+/**
+ * @brief  获取当前采集模式
+ * @param  无
+ * @retval ADC_ACQ_INDEPENDENT / ADC_ACQ_SIMULT / ADC_ACQ_INTERLEAVED
+ */
+uint8_t ADC_GetAcquisitionMode(void)
+{
+    return adc_acq_mode;
+}
+
+/**
+ * @brief  获取每帧逻辑通道数
+ * @note   双ADC模式下为扫描通道数的2倍
+ * @param  无
+ * @retval 通道数
+ */
+uint8_t ADC_GetChannelCount(void)
+{
+    return adc_frame_width;
+}
+
+/**
+ * @brief  设置通道报警阈值
+ * @note   同时按实测VDDA修正通道换算系数; 阈值预先换算为12位ADC值,
+ *         ADC_ReadAll中直接整数比较
+ * @param  index: 通道在ADC1扫描序列中的序号(双ADC模式下配对通道共用)
+ * @param  threshold: 阈值(0.01单位)
+ * @retval 0 - 成功, 1 - 序号无效
+ */
+uint8_t ADC_SetChannelThreshold(uint8_t index, int32_t threshold)
+{
+    ADC_ChannelConfigTypeDef *config;
+    uint32_t scale;
+    int64_t counts;
+    
+    if (index >= adc_channel_count)
+        return 1;
+    
+    config = &adc_channels[index];
+    config->threshold = threshold;
+    
+    /* 通道系数按标称VDDA给出, 比例换算到实测VDDA */
+    scale = (uint32_t)(((uint64_t)config->scale_q16 * adc_vdda_mv + ADC_VREF_MV / 2) / ADC_VREF_MV);
+    adc_scale_q16[index] = scale;
+    
+    /* counts = (阈值 - 偏移) / 每LSB物理量, 仅在配置时做一次除法 */
+    if (scale == 0)
+    {
+        counts = 4095;
+    }
+    else
+    {
+        counts = (((int64_t)(threshold - config->offset) << 16) + scale / 2) / scale;
+    }
+    
+    if (counts < 0)
+        counts = 0;
+    if (counts > 4095)
+        counts = 4095;
+    adc_threshold_counts[index] = (uint16_t)counts;
+    
+    return 0;
+}
+
+/**
+ * @brief  设置ADC采样率
+ * @note   每次触发转换整个扫描序列, 采样率即每通道的采样率;
+ *         新的PSC/ARR在下一次更新事件生效, 采样间隔不会出现异常短周期
+ * @param  rate_hz: 采样率, 范围ADC_SAMPLE_RATE_MIN ~ ADC_GetMaxSampleRate()
+ * @retval 实际采样率(Hz, 四舍五入)
+ */
+uint32_t ADC_SetSampleRate(uint32_t rate_hz)
+{
+    uint32_t ticks, prescaler, period, max_rate;
+    
+    /* 交替模式不使用定时器, 仅保存设定 */
+    if (adc_acq_mode == ADC_ACQ_INTERLEAVED)
+    {
+        adc_sample_rate = rate_hz;
+        adc_frame_ticks = ADC_TRIG_TIM_CLK / ADC_GetSampleRate();
+        return ADC_GetSampleRate();
+    }
+    
+    /* 限幅 */
+    max_rate = ADC_GetMaxSampleRate();
+    if (rate_hz < ADC_SAMPLE_RATE_MIN)
+        rate_hz = ADC_SAMPLE_RATE_MIN;
+    if (rate_hz > max_rate)
+        rate_hz = max_rate;
+    
+    /* 计算一个采样周期的定时器时钟数, 拆分为预分频和自动重装值(均为16位) */
+    ticks = ADC_TRIG_TIM_CLK / rate_hz;
+    prescaler = (ticks - 1) / 0x10000 + 1;
+    period = (ticks + prescaler / 2) / prescaler;
+    
+    TIM_PrescalerConfig(TIM3, (uint16_t)(prescaler - 1), TIM_PSCReloadMode_Update);
+    TIM_SetAutoreload(TIM3, (uint16_t)(period - 1));
+    
+    adc_sample_rate = (ADC_TRIG_TIM_CLK + prescaler * period / 2) / (prescaler * period);
+    adc_frame_ticks = prescaler * period;
+    
+    /* 两次触发之间除一帧扫描外还须容纳内部通道注入转换 */
+    adc_internal_allowed = (ADC_ADCCLK * 2 / adc_sample_rate >= ADC_FrameCycles_x2() + ADC_INTERNAL_CYCLES_X2) ? 1 : 0;
+    
+    return adc_sample_rate;
+}
+
+/**
+ * @brief  获取当前采样率
+ * @param  无
+ * @retval 采样率(Hz)
+ */
+uint32_t ADC_GetSampleRate(void)
+{
+    /* 交替模式: 每个ADC每14个ADC周期(1.5采样+12.5转换)输出一帧 */
+    if (adc_acq_mode == ADC_ACQ_INTERLEAVED)
+        return ADC_ADCCLK / 14;
+    
+    return adc_sample_rate;
+}
+
+/**
+ * @brief  获取当前通道配置下的最高采样率
+ * @note   一帧扫描须在下一次触发前完成
+ * @param  无
+ * @retval 最高采样率(Hz)
+ */
+uint32_t ADC_GetMaxSampleRate(void)
+{
+    uint32_t max_rate = ADC_ADCCLK * 2 / ADC_FrameCycles_x2();
+    
+    return (max_rate > ADC_SAMPLE_RATE_MAX) ? ADC_SAMPLE_RATE_MAX : max_rate;
+}
+
+/**
+ * @brief  设置模拟看门狗阈值
+ * @note   看门狗硬件逐点比较第一个通道的12位原始值, 超过trip进入报警,
+ *         低于release解除报警, 两者之差即回差
+ * @param  trip: 报警阈值(ADC值)
+ * @param  release: 解除阈值(ADC值), 须小于trip
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t ADC_WatchdogConfig(uint16_t trip, uint16_t release)
+{
+    if (trip > 4095 || release >= trip)
+        return 1;
+    
+    ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE);
+    adc_wd_trip = trip;
+    adc_wd_release = release;
+    ADC_WatchdogApply();
+    ADC_ClearITPendingBit(ADC1, ADC_IT_AWD);
+    adc_wd_armed = 1;
+    ADC_ITConfig(ADC1, ADC_IT_AWD, ENABLE);
+    
+    return 0;
+}
+
+/**
+ * @brief  看门狗触发后重新使能
+ * @note   看门狗逐点比较单个原始值, 阈值附近的噪声会使窗口来回翻转, 在最高优先级的
+ *         ADC1_2中断中反复进出. 因此触发一次后即关闭中断, 由主循环在滤波值离开
+ *         [release, trip]回差带后重新使能: 滤波值仍在带内时保持当前报警状态.
+ *         重新使能时若原始值已越过新窗口, 中断立即再次触发, 状态随之翻转
+ * @param  filtered: 第一个通道的滤波值(12位ADC值)
+ * @retval 无
+ */
+void ADC_WatchdogRearm(uint16_t filtered)
+{
+    if (adc_wd_armed || (filtered >= adc_wd_release && filtered <= adc_wd_trip))
+        return;
+    
+    ADC_ClearITPendingBit(ADC1, ADC_IT_AWD);
+    adc_wd_armed = 1;
+    ADC_ITConfig(ADC1, ADC_IT_AWD, ENABLE);
+}
+
+/**
+ * @brief  设置看门狗报警回调
+ * @param  callback: 回调函数, 在ADC1_2中断中调用, 传入0取消
+ * @retval 无
+ */
+void ADC_SetWatchdogCallback(ADC_WatchdogCallback callback)
+{
+    adc_wd_callback = callback;
+}
+
+/**
+ * @brief  获取看门狗报警状态
+ * @param  无
+ * @retval 1 - 报警, 0 - 正常
+ */
+uint8_t ADC_GetWatchdogAlarm(void)
+{
+    return adc_wd_alarm;
+}
+
+/**
+ * @brief  请求一次快照读取
+ * @note   用注入组立即转换指定通道, 插入正在进行的规则组转换之前, 规则组DMA流
+ *         不中断(被打断的那次转换延后约一次快照转换时间). 快照依次排队,
+ *         完成后在ADC1_2中断中回调; 仅独立模式下可用
+ * @param  channel: ADC通道号 ADC_Channel_0 ~ ADC_Channel_17
+ * @param  callback: 完成回调, 在ADC1_2中断中调用
+ * @retval 0 - 已排队, 1 - 参数无效、模式不支持或队列已满
+ */
+uint8_t ADC_SnapshotRequest(uint8_t channel, ADC_SnapshotCallback callback)
+{
+    uint8_t next;
+    
+    if (channel > ADC_Channel_17 || callback == 0 || adc_acq_mode != ADC_ACQ_INDEPENDENT)
+        return 1;
+    
+    /* 关中断入队, 防止与DMA中断和ADC1_2中断竞争注入组 */
+    __disable_irq();
+    next = (adc_snapshot_head + 1) % ADC_SNAPSHOT_QUEUE_SIZE;
+    if (next == adc_snapshot_tail)
+    {
+        __enable_irq();
+        return 1;
+    }
+    adc_snapshot_queue[adc_snapshot_head].channel = channel;
+    adc_snapshot_queue[adc_snapshot_head].callback = callback;
+    adc_snapshot_queue[adc_snapshot_head].start = GetCycleCount();
+    adc_snapshot_head = next;
+    
+    /* 注入组空闲则立即启动 */
+    if (adc_inj_job == ADC_INJ_IDLE)
+        ADC_SnapshotNext();
+    __enable_irq();
+    
+    return 0;
+}
+
+/**
+ * @brief  获取快照延迟
+ * @param  max: 输出延迟峰值(CPU周期数), 可传0
+ * @retval 最近一次快照从请求到回调的CPU周期数
+ */
+uint32_t ADC_GetSnapshotLatency(uint32_t *max)
+{
+    if (max)
+        *max = adc_snapshot_latency_max;
+    
+    return adc_snapshot_latency;
+}
+
+/**
+ * @brief  获取块内指定帧的触发时刻
+ * @note   由块时间戳按帧间隔向前推算, 可在回调或主循环中调用
+ * @param  block: 数据块
+ * @param  frame: 帧序号, 0 ~ block->length - 1
+ * @retval 触发时刻(us, GetSysTime_us时基)
+ */
+uint32_t ADC_GetFrameTime(const ADC_BlockTypeDef *block, uint16_t frame)
+{
+    uint16_t back = block->length - 1 - frame;
+    
+    return block->timestamp - (uint32_t)((uint64_t)back * block->period / (ADC_TRIG_TIM_CLK / 1000000));
+}
+
+/**
+ * @brief  请求一次后台校准(非阻塞)
+ * @note   在下一次DMA缓冲区回绕时暂停规则组, 断电后重新校准ADC1(及ADC2), 完成后
+ *         自动恢复. 采样时钟不停, 暂停期间缺失的帧数由数据块gap标出, 通常为4帧.
+ *         交替模式为连续转换, 无法在帧边界暂停, 不支持
+ * @param  无
+ * @retval 0 - 已请求, 1 - 模式不支持或校准已在进行
+ */
+uint8_t ADC_Recalibrate(void)
+{
+    if (adc_acq_mode == ADC_ACQ_INTERLEAVED || adc_recal_state != ADC_RECAL_IDLE)
+        return 1;
+    
+    adc_recal_state = ADC_RECAL_PENDING;
+    
+    return 0;
+}
+
+/**
+ * @brief  获取后台校准统计
+ * @param  last_gap: 输出最近一次校准缺失的帧数, 可传0
+ * @retval 已完成的后台校准次数
+ */
+uint32_t ADC_GetRecalCount(uint16_t *last_gap)
+{
+    if (last_gap)
+        *last_gap = adc_recal_last_gap;
+    
+    return adc_recal_count;
+}
+
+/**
+ * @brief  计算DMA最后写完的一帧在缓冲区中的起始位置
+ * @param  无
+ * @retval 帧起始位置
+ */
+static uint16_t ADC_LastFrameIndex(void)
+{
+    uint16_t written;
+    uint16_t frames;
+    
+    /* CNDTR为剩余传输数(双ADC模式以字计), 由此推算本轮已完整写入的帧数 */
+    if (adc_acq_mode != ADC_ACQ_INDEPENDENT)
+        written = adc_dma_length - DMA_GetCurrDataCounter(DMA1_Channel1) * 2;
+    else
+        written = adc_dma_length - DMA_GetCurrDataCounter(DMA1_Channel1);
+    
+    frames = written / adc_frame_width;
+    if (frames == 0)
+    {
+        /* 刚回绕, 最新一帧位于缓冲区末尾 */
+        frames = adc_dma_length / adc_frame_width;
+    }
+    
+    return (frames - 1) * adc_frame_width;
+}
+
+/**
+ * @brief  一次读取所有通道最新值
+ * @note   取DMA缓冲区中最新完整的一帧, 无需等待任何转换;
+ *         最后追加一个板温通道(芯片内部温度传感器, 不参与报警)
+ * @param  data: 输出数组, 至少ADC_GetChannelCount() + 1个元素
+ * @retval 通道数(含板温通道)
+ */
+uint8_t ADC_ReadAll(ADC_ChannelDataTypeDef *data)
+{
+    uint16_t index = ADC_LastFrameIndex();
+    uint8_t i, k;
+    
+    for (i = 0; i < adc_frame_width; i++)
+    {
+        /* 双ADC模式下配对通道共用ADC1序列位置的换算参数 */
+        k = (adc_acq_mode != ADC_ACQ_INDEPENDENT) ? (i >> 1) : i;
+    
+        data[i].raw = adc_dma_buffer.half[index + i];
+        data[i].value = (int32_t)(((uint64_t)data[i].raw * adc_scale_q16[k] + 0x8000) >> 16)
+                        + adc_channels[k].offset;
+        data[i].alarm = (data[i].raw > adc_threshold_counts[k]) ? 1 : 0;
+    }
+    
+    /* 板温通道 */
+    data[i].raw = adc_ts_raw;
+    data[i].value = adc_board_temp;
+    data[i].alarm = 0;
+    
+    return adc_frame_width + 1;
 }
 
 /**
  * @brief  获取ADC转换结果
+ * @note   直接读取DMA缓冲区中第一个通道最新的采样点, 不等待EOC
  * @param  无
  * @retval 原始ADC值
  */
 uint16_t ADC_GetValue(void)
 {
-    /* 等待转换完成 */
-    while(ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC) == RESET);
-    
     /* 返回ADC1转换结果 */
-    return ADC_GetConversionValue(ADC1);
+    return adc_dma_buffer.half[ADC_LastFrameIndex()];
 }
 
 /**
  * @brief  获取当前温度值
+ * @note   单个采样, 未经积分, 含工频干扰; 连续测量应使用工频同步的过采样输出
  * @param  无
- * @retval 温度值(摄氏度)
+ * @retval 温度值(0.01摄氏度)
+ */
+int32_t ADC_GetTemperature(void)
+{
+    /* 获取ADC值并转换 */
+    return ADC_ConvertTemperature(ADC_GetValue(), 12);
+}
+
+/**
+ * @brief  将ADC值转换为温度
+ * @note   纯整数运算: 温度 = value * (满量程温度/4095, Q16) >> (16 + bits - 12),
+ *         满量程温度按实测VDDA修正, 过采样输出的满量程为 4095 << (bits - 12)
+ * @param  value: ADC值
+ * @param  bits: ADC值位宽(12~16)
+ * @retval 温度值(0.01摄氏度)
  */
-float ADC_GetTemperature(void)
+int32_t ADC_ConvertTemperature(uint32_t value, uint8_t bits)
 {
-    uint16_t adcValue;
-    float voltage, temperature;
+    uint8_t shift = 16 + (bits - 12);
     
-    /* 获取ADC值 */
-    adcValue = ADC_GetValue();
+    /* 32x32->64位乘法(UMULL), 加半LSB四舍五入 */
+    return (int32_t)(((uint64_t)value * adc_temp_scale_q16 + (1u << (shift - 1))) >> shift);
+}
+
+/**
+ * @brief  将温度转换为ADC值
+ * @note   用于把温度阈值预先换算到ADC计数空间, 比较时无需逐点转换
+ * @param  centi: 温度值(0.01摄氏度)
+ * @param  bits: ADC值位宽(12~16)
+ * @retval ADC值
+ */
+uint32_t ADC_TemperatureToCounts(int32_t centi, uint8_t bits)
+{
+    uint32_t fullscale = 4095u << (bits - 12);
+    uint32_t fullscale_centi = adc_vdda_mv * 10u;
+    
+    /* 限幅到ADC量程 */
+    if (centi <= 0)
+        return 0;
+    if ((uint32_t)centi >= fullscale_centi)
+        return fullscale;
     
-    /* ADC值转换为电压: 0-4095 -> 0-3.3V */
-    voltage = (float)adcValue * 3.3f / 4095.0f;
+    /* centi * fullscale 最大 36000 * 65520, 不超过32位 */
+    return ((uint32_t)centi * fullscale + fullscale_centi / 2) / fullscale_centi;
+}
+
+/**
+ * @brief  获取VDDA电压
+ * @note   由Vrefint后台采样估算并经低通滤波; Vrefint按典型值计算,
+ *         为未校准估计值, 绝对误差约±3%
+ * @param  无
+ * @retval VDDA(mV)
+ */
+uint16_t ADC_GetSupplyVoltage(void)
+{
+    return adc_vdda_mv;
+}
+
+/**
+ * @brief  获取板温
+ * @note   芯片内部温度传感器, 绝对精度约±1.5°C, 适合监测板级温升
+ * @param  无
+ * @retval 温度值(0.01摄氏度)
+ */
+int32_t ADC_GetBoardTemperature(void)
+{
+    return adc_board_temp;
+}
+
+#ifdef ADC_FIXED_POINT_SELFTEST
+/**
+ * @brief  定点转换精度自检
+ * @note   遍历12位输入0~4095及16位输入全量程, 与浮点参考公式比较
+ * @param  无
+ * @retval 最大绝对误差(0.01摄氏度)
+ */
+uint32_t ADC_FixedPointSelfTest(void)
+{
+    uint32_t value, bits, max_error = 0;
+    int32_t fixed, reference;
+    float voltage;
+    
+    for (bits = 12; bits <= 16; bits += 4)
+    {
+        for (value = 0; value <= (4095u << (bits - 12)); value++)
+        {
+            /* 浮点参考: 原始的 voltage * 100 公式, 参考电压取实测VDDA */
+            voltage = (float)value * (float)adc_vdda_mv / 1000.0f / (float)(4095u << (bits - 12));
+            reference = (int32_t)(voltage * 100.0f * 100.0f + 0.5f);
+    
+            fixed = ADC_ConvertTemperature(value, (uint8_t)bits);
+    
+            if ((uint32_t)(fixed > reference ? fixed - reference : reference - fixed) > max_error)
+                max_error = (uint32_t)(fixed > reference ? fixed - reference : reference - fixed);
+        }
+    }
+    
+    return max_error;
+}
+#endif
+
+/**
+ * @brief  非阻塞获取最新完成的数据块
+ * @note   数据块直接指向DMA缓冲区, 须在下一个半缓冲周期内处理完毕
+ * @param  block: 输出的数据块描述
+ * @retval 1 - 获取到新数据块, 0 - 暂无新数据
+ */
+uint8_t ADC_GetBlock(ADC_BlockTypeDef *block)
+{
+    if (!adc_block_ready)
+    {
+        return 0;
+    }
+    
+    /* 关中断拷贝描述, 防止被DMA中断改写 */
+    __disable_irq();
+    *block = adc_ready_block;
+    adc_block_ready = 0;
+    __enable_irq();
+    
+    return 1;
+}
+
+/**
+ * @brief  设置半传输完成回调
+ * @param  callback: 回调函数, 在DMA中断中调用, 传入0取消
+ * @retval 无
+ */
+void ADC_SetHalfCpltCallback(ADC_BlockCallback callback)
+{
+    adc_half_cplt_callback = callback;
+}
+
+/**
+ * @brief  设置全传输完成回调
+ * @param  callback: 回调函数, 在DMA中断中调用, 传入0取消
+ * @retval 无
+ */
+void ADC_SetCpltCallback(ADC_BlockCallback callback)
+{
+    adc_cplt_callback = callback;
+}
+
+/**
+ * @brief  获取数据块覆盖计数
+ * @note   主循环未及时调用ADC_GetBlock时计数, 回调方式不受影响
+ * @param  无
+ * @retval 被覆盖的数据块数
+ */
+uint32_t ADC_GetOverrunCount(void)
+{
+    return adc_overrun_count;
+}
+
+/**
+ * @brief  计算刚完成的数据块最后一帧的触发时刻
+ * @note   由当前时刻减去距TIM3最近一次更新事件的时间得到该次触发的时刻;
+ *         中断响应较晚时块后已有帧开始转换, 按DMA位置和帧转换时间扣除相应帧数.
+ *         TIM3与SysTick同源于72MHz系统时钟, 精度为1us.
+ *         交替模式连续转换, 只按DMA位置扣除, 误差在一帧以内
+ * @param  offset: 数据块在DMA缓冲区中的起始位置
+ * @retval 触发时刻(us)
+ */
+static uint32_t ADC_BlockTimestamp(uint16_t offset)
+{
+    uint32_t now = GetSysTime_us();
+    uint32_t elapsed = (uint32_t)TIM3->CNT * ((uint32_t)TIM3->PSC + 1);
+    uint16_t transfer = (adc_acq_mode == ADC_ACQ_INDEPENDENT) ? 1 : 2;  // 每次DMA传输的半字数
+    uint16_t written, extra, frames;
+    
+    /* 块结束位置之后已写入的半字数 */
+    written = adc_dma_length - DMA_GetCurrDataCounter(DMA1_Channel1) * transfer;
+    extra = (written + adc_dma_length - (offset + adc_dma_length / 2)) % adc_dma_length;
+    frames = extra / adc_frame_width;
+    
+    if (adc_acq_mode == ADC_ACQ_INTERLEAVED)
+        return now - (uint32_t)((uint64_t)frames * adc_frame_ticks / (ADC_TRIG_TIM_CLK / 1000000));
+    
+    /* 最近一次触发的帧尚未转换完, 说明它不是本块的最后一帧 */
+    if (elapsed < ADC_FrameCycles_x2() * (ADC_TRIG_TIM_CLK / ADC_ADCCLK / 2))
+        frames++;
+    
+    return now - (uint32_t)(((uint64_t)frames * adc_frame_ticks + elapsed) / (ADC_TRIG_TIM_CLK / 1000000));
+}
+
+/**
+ * @brief  数据块完成处理
+ * @param  offset: 数据块在DMA缓冲区中的起始位置
+ * @param  callback: 对应的回调函数
+ * @retval 无
+ */
+static void ADC_BlockComplete(uint16_t offset, ADC_BlockCallback callback)
+{
+    if (adc_block_ready)
+    {
+        /* 上一块尚未被主循环读取 */
+        adc_overrun_count++;
+    }
+    
+    adc_ready_block.data = (const uint16_t *)&adc_dma_buffer.half[offset];
+    adc_ready_block.length = adc_frames_per_block;
+    adc_ready_block.channels = adc_frame_width;
+    adc_ready_block.seq = adc_block_seq++;
+    adc_ready_block.gap = adc_gap_pending;
+    adc_gap_pending = 0;
+    adc_ready_block.timestamp = ADC_BlockTimestamp(offset);
+    adc_ready_block.period = adc_frame_ticks;
+    adc_block_ready = 1;
+    
+    if (callback)
+    {
+        callback(&adc_ready_block);
+    }
+}
+
+/**
+ * @brief  DMA1通道1中断处理函数
+ * @note   半传输: 前半缓冲区就绪; 全传输: 后半缓冲区就绪
+ * @param  无
+ * @retval 无
+ */
+void DMA1_Channel1_IRQHandler(void)
+{
+    /* 待校准时在回绕处暂停, 须在下一帧触发之前, 故最先处理 */
+    if (adc_recal_state == ADC_RECAL_PENDING && DMA_GetITStatus(DMA1_IT_TC1) != RESET)
+        ADC_RecalStart();
+    
+    /* 先处理内部通道, 注入转换尽早启动 */
+    ADC_InternalSample();
+    
+    if (DMA_GetITStatus(DMA1_IT_HT1) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_HT1);
+        ADC_BlockComplete(0, adc_half_cplt_callback);
+    }
+    
+    if (DMA_GetITStatus(DMA1_IT_TC1) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC1);
+        ADC_BlockComplete(adc_dma_length / 2, adc_cplt_callback);
+    }
+}
+
+/**
+ * @brief  ADC1_2中断处理函数
+ * @note   模拟看门狗触发: 切换报警状态并翻转窗口, 直接回调驱动报警输出;
+ *         先改窗口再清标志, 避免旧窗口下的转换再次置位; 随后关闭看门狗中断,
+ *         由主循环调用ADC_WatchdogRearm重新使能.
+ *         注入组完成: 取回内部通道或快照结果, 并启动下一个排队的快照
+ * @param  无
+ * @retval 无
+ */
+void ADC1_2_IRQHandler(void)
+{
+    if (ADC_GetITStatus(ADC1, ADC_IT_AWD) != RESET)
+    {
+        adc_wd_alarm = !adc_wd_alarm;
+        ADC_WatchdogApply();
+        ADC_ITConfig(ADC1, ADC_IT_AWD, DISABLE);
+        adc_wd_armed = 0;
+        ADC_ClearITPendingBit(ADC1, ADC_IT_AWD);
+        
+        if (adc_wd_callback)
+        {
+            adc_wd_callback(adc_wd_alarm);
+        }
+    }
+    
+    if (ADC_GetITStatus(ADC1, ADC_IT_JEOC) != RESET)
+    {
+        ADC_ClearITPendingBit(ADC1, ADC_IT_JEOC);
+        
+        if (adc_inj_job == ADC_INJ_INTERNAL)
+        {
+            adc_vref_raw = ADC_GetInjectedConversionValue(ADC1, ADC_InjectedChannel_1);
+            adc_ts_new_raw = ADC_GetInjectedConversionValue(ADC1, ADC_InjectedChannel_2);
+            adc_internal_result = 1;
+            adc_inj_job = ADC_INJ_IDLE;
+            ADC_SnapshotNext();
+        }
+        else if (adc_inj_job == ADC_INJ_SNAPSHOT)
+        {
+            ADC_SnapshotTypeDef snapshot = adc_snapshot_queue[adc_snapshot_tail];
+            uint16_t value = ADC_GetInjectedConversionValue(ADC1, ADC_InjectedChannel_1);
+            
+            /* 出队并立即启动下一个, 再执行回调 */
+            adc_snapshot_tail = (adc_snapshot_tail + 1) % ADC_SNAPSHOT_QUEUE_SIZE;
+            adc_inj_job = ADC_INJ_IDLE;
+            ADC_SnapshotNext();
+            
+            adc_snapshot_latency = GetCycleCount() - snapshot.start;
+            if (adc_snapshot_latency > adc_snapshot_latency_max)
+                adc_snapshot_latency_max = adc_snapshot_latency;
+            snapshot.callback(snapshot.channel, value);
+        }
+    }
+}
+
+/**
+ * @brief  TIM3中断处理函数
+ * @note   仅在后台校准期间使能更新中断: 每个更新事件计一个缺失帧,
+ *         依次推进 断电 -> 上电 -> 复位校准 -> 校准, 校准完成后恢复采集
+ * @param  无
+ * @retval 无
+ */
+void TIM3_IRQHandler(void)
+{
+    if (TIM_GetITStatus(TIM3, TIM_IT_Update) == RESET)
+        return;
+    TIM_ClearITPendingBit(TIM3, TIM_IT_Update);
     
-    /* LM35转换: 每10mV代表1摄氏度 */
-    temperature = voltage * 100.0f;
+    adc_recal_frames++;
     
-    return temperature;
+    if (adc_recal_state == ADC_RECAL_POWER_OFF)
+    {
+        /* 已断电至少一个帧间隔, 重新上电(ADON由0置1只唤醒, 不启动转换) */
+        ADC_Cmd(ADC1, ENABLE);
+        if (adc2_enabled)
+            ADC_Cmd(ADC2, ENABLE);
+        adc_recal_state = ADC_RECAL_POWER_ON;
+    }
+    else if (adc_recal_state == ADC_RECAL_POWER_ON)
+    {
+        /* 上电已稳定, 复位校准寄存器 */
+        ADC_ResetCalibration(ADC1);
+        if (adc2_enabled)
+            ADC_ResetCalibration(ADC2);
+        adc_recal_state = ADC_RECAL_RESET;
+    }
+    else if (adc_recal_state == ADC_RECAL_RESET)
+    {
+        if (ADC_GetResetCalibrationStatus(ADC1) || (adc2_enabled && ADC_GetResetCalibrationStatus(ADC2)))
+            return;
+        
+        ADC_StartCalibration(ADC1);
+        if (adc2_enabled)
+            ADC_StartCalibration(ADC2);
+        adc_recal_state = ADC_RECAL_CALIB;
+    }
+    else if (adc_recal_state == ADC_RECAL_CALIB)
+    {
+        if (ADC_GetCalibrationStatus(ADC1) || (adc2_enabled && ADC_GetCalibrationStatus(ADC2)))
+            return;
+        
+        ADC_RecalResume();
+    }
 }
@@ -1,4 +1,4 @@
-/* 
+/*
  * 描述: ADC模块头文件
  * 功能: 声明ADC相关函数
  */
@@ -8,9 +8,123 @@
 
 #include "stm32f10x.h"
 
+/* DMA环形缓冲区参数 */
+#define ADC_DMA_BUF_SIZE    256                     // DMA环形缓冲区容量(采样点数)
+#define ADC_BLOCK_SIZE      (ADC_DMA_BUF_SIZE / 2)  // 半传输/全传输各对应一个数据块
+
+/* 扫描通道参数 */
+#define ADC_MAX_CHANNELS    10          // 最多扫描通道数: PA0~PA7(通道0~7), PB0~PB1(通道8~9)
+#define ADC_MAX_FRAME_WIDTH (ADC_MAX_CHANNELS * 2)  // 每帧最多逻辑通道数(双ADC同步模式)
+#define ADC_MAX_READ_CHANNELS (ADC_MAX_FRAME_WIDTH + 1) // ADC_ReadAll最多输出通道数(含板温通道)
+#define ADC_ADCCLK          12000000    // ADC时钟 PCLK2/6
+
+/* 采集模式 */
+#define ADC_ACQ_INDEPENDENT     0           // 独立模式: 仅ADC1扫描
+#define ADC_ACQ_SIMULT          1           // 规则同步模式: ADC1/ADC2同时转换配对通道
+#define ADC_ACQ_INTERLEAVED     2           // 快速交替模式: ADC1/ADC2交替转换同一通道, 采样率翻倍
+
+/* 定时器触发采样参数 (TIM3 TRGO触发ADC1规则组) */
+#define ADC_TRIG_TIM_CLK        72000000    // TIM3计数时钟 (APB1 36MHz x2)
+#define ADC_SAMPLE_RATE_MIN     1           // 最低采样率 1Hz
+#define ADC_SAMPLE_RATE_MAX     40000       // 最高采样率 40kHz (单次转换约21us)
+#define ADC_SAMPLE_RATE_DEFAULT 1000        // 默认采样率 1kHz
+
+/* 不可用作模拟输入的通道: PA0为绿灯输出, PA1为红灯PWM输出 */
+#define ADC_CHANNEL_RESERVED_MASK   ((1u << ADC_Channel_0) | (1u << ADC_Channel_1))
+
+/* 定点温度转换参数 (LM35: 10mV/°C, 温度单位0.01°C) */
+#define ADC_VREF_MV             3300        // ADC参考电压标称值(mV), 实际值由Vrefint测得
+#define ADC_FULLSCALE_CENTI     (ADC_VREF_MV * 10)  // 满量程对应温度(0.01°C)
+#define ADC_CENTI_SCALE_Q16     ((uint32_t)((((uint64_t)ADC_FULLSCALE_CENTI << 16) + 2047) / 4095))  // 标称VDDA下每LSB温度, Q16
+
+/* 内部通道参数 (通道17 Vrefint, 通道16 温度传感器) */
+#define ADC_VREFINT_MV          1200        // 内部参考电压典型值(mV), 未逐片校准, 器件间偏差约±3%
+#define ADC_VDDA_MIN_MV         2000        // VDDA有效范围下限(mV)
+#define ADC_VDDA_MAX_MV         3600        // VDDA有效范围上限(mV)
+#define ADC_VDDA_HYST_MV        2           // VDDA变化超过该值才更新换算系数(mV)
+#define ADC_TS_V25_UV           1430000     // 温度传感器25°C输出电压(uV)
+#define ADC_TS_SLOPE_UV         4300        // 温度传感器斜率(uV/°C)
+#define ADC_INTERNAL_INTERVAL   16          // 每隔多少个数据块采样一次内部通道
+
+/* 快照读取参数 (注入组) */
+#define ADC_SNAPSHOT_QUEUE_SIZE     4                           // 快照请求队列容量(可排队数为容量-1)
+#define ADC_SNAPSHOT_SAMPLE_TIME    ADC_SampleTime_55Cycles5    // 快照采样时间: (55.5+12.5)/12MHz = 5.7us
+#define ADC_SNAPSHOT_INTERNAL_SAMPLE_TIME ADC_SampleTime_239Cycles5 // 内部通道16/17: 手册要求采样不少于17.1us, 239.5/12MHz = 20us
+
+/* 定义后编译定点转换精度自检(会引入软件浮点库, 仅调试使用) */
+/* #define ADC_FIXED_POINT_SELFTEST */
+
+/* ADC数据块描述 */
+typedef struct
+{
+    const uint16_t *data;   // 数据块起始地址(直接指向DMA缓冲区, 零拷贝)
+    uint16_t length;        // 每通道采样点数(帧数)
+    uint8_t channels;       // 每帧通道数, 第k帧通道i的数据为 data[k * channels + i]
+    uint32_t seq;           // 数据块序号, 连续递增, 用于检测丢块
+    uint16_t gap;           // 本块之前因后台校准缺失的帧数, 0 - 与上一块连续
+    uint32_t timestamp;     // 最后一帧的触发时刻(us, GetSysTime_us时基)
+    uint32_t period;        // 帧间隔(TIM3时钟数, ADC_TRIG_TIM_CLK)
+} ADC_BlockTypeDef;
+
+/* 扫描通道配置 */
+typedef struct
+{
+    uint8_t channel;        // ADC通道号 ADC_Channel_2 ~ ADC_Channel_9 (通道0/1引脚用作输出)
+    uint8_t sample_time;    // 采样时间 ADC_SampleTime_xxx
+    uint32_t scale_q16;     // 每LSB对应物理量(0.01单位), Q16; LM35为ADC_CENTI_SCALE_Q16
+    int32_t offset;         // 零点偏移(0.01单位)
+    int32_t threshold;      // 报警阈值(0.01单位)
+} ADC_ChannelConfigTypeDef;
+
+/* 通道读数 */
+typedef struct
+{
+    uint16_t raw;           // 最新原始值
+    int32_t value;          // 换算后的物理量(0.01单位)
+    uint8_t alarm;          // 1 - 超过通道阈值
+} ADC_ChannelDataTypeDef;
+
+/* 数据块回调函数类型(在DMA中断中调用) */
+typedef void (*ADC_BlockCallback)(const ADC_BlockTypeDef *block);
+
+/* 模拟看门狗报警回调函数类型(在ADC1_2中断中调用), alarm: 1 - 进入报警, 0 - 解除报警 */
+typedef void (*ADC_WatchdogCallback)(uint8_t alarm);
+
+/* 快照完成回调函数类型(在ADC1_2中断中调用) */
+typedef void (*ADC_SnapshotCallback)(uint8_t channel, uint16_t value);
+
 /* 函数声明 */
 void ADC_Config(void);              // 配置ADC
-uint16_t ADC_GetValue(void);        // 获取ADC转换结果
-float ADC_GetTemperature(void);     // 获取温度值
+uint8_t ADC_ScanConfig(const ADC_ChannelConfigTypeDef *channels, uint8_t count); // 配置扫描通道列表
+uint8_t ADC_SetAcquisitionMode(uint8_t mode, const uint8_t *pair_channels); // 设置采集模式(独立/同步/交替)
+uint8_t ADC_GetAcquisitionMode(void);   // 获取当前采集模式
+uint8_t ADC_GetChannelCount(void);  // 获取每帧逻辑通道数
+uint8_t ADC_SetChannelThreshold(uint8_t index, int32_t threshold);  // 设置通道报警阈值
+uint8_t ADC_ReadAll(ADC_ChannelDataTypeDef *data);      // 一次读取所有通道及板温最新值(非阻塞)
+uint16_t ADC_GetValue(void);        // 获取第一个通道最新一次ADC转换结果(非阻塞)
+int32_t ADC_GetTemperature(void);   // 获取温度值(0.01°C)
+int32_t ADC_ConvertTemperature(uint32_t value, uint8_t bits);     // 将指定位宽的ADC值转换为温度(0.01°C)
+uint32_t ADC_TemperatureToCounts(int32_t centi, uint8_t bits);    // 将温度(0.01°C)转换为指定位宽的ADC值
+uint16_t ADC_GetSupplyVoltage(void);    // 获取由Vrefint估算的VDDA(mV), 未校准
+int32_t ADC_GetBoardTemperature(void);  // 获取芯片内部温度传感器温度(0.01°C)
+uint8_t ADC_GetBlock(ADC_BlockTypeDef *block);          // 非阻塞获取最新完成的数据块
+void ADC_SetHalfCpltCallback(ADC_BlockCallback callback); // 设置半传输完成回调
+void ADC_SetCpltCallback(ADC_BlockCallback callback);     // 设置全传输完成回调
+uint32_t ADC_GetOverrunCount(void); // 获取未及时读取而被覆盖的数据块数
+uint32_t ADC_GetFrameTime(const ADC_BlockTypeDef *block, uint16_t frame); // 获取块内指定帧的触发时刻(us)
+uint32_t ADC_SetSampleRate(uint32_t rate_hz);           // 设置采样率(每帧), 返回实际采样率
+uint32_t ADC_GetSampleRate(void);   // 获取当前采样率(Hz)
+uint32_t ADC_GetMaxSampleRate(void);    // 获取当前通道配置下的最高采样率(Hz)
+uint8_t ADC_WatchdogConfig(uint16_t trip, uint16_t release);  // 设置第一个通道的看门狗报警/解除阈值(ADC值)
+void ADC_WatchdogRearm(uint16_t filtered); // 滤波值离开回差带后重新使能看门狗中断
+void ADC_SetWatchdogCallback(ADC_WatchdogCallback callback);  // 设置看门狗报警回调
+uint8_t ADC_GetWatchdogAlarm(void);     // 获取看门狗报警状态
+uint8_t ADC_SnapshotRequest(uint8_t channel, ADC_SnapshotCallback callback); // 请求一次注入组快照读取(异步)
+uint32_t ADC_GetSnapshotLatency(uint32_t *max); // 获取快照请求到回调的CPU周期数
+uint8_t ADC_Recalibrate(void);      // 请求一次后台校准(非阻塞)
+uint32_t ADC_GetRecalCount(uint16_t *last_gap); // 获取后台校准次数及最近一次缺失帧数
+#ifdef ADC_FIXED_POINT_SELFTEST
+uint32_t ADC_FixedPointSelfTest(void);  // 定点转换与浮点参考对比, 返回最大误差(0.01°C)
+#endif
 
 #endif /* __ADC_H */
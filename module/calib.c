@@ -0,0 +1,291 @@
+/*
+ * 文件名: calib.c
+ * 描述: 传感器校准模块
+ * 功能: 维护各通道多点校准表, 存储于Flash保留页, 按预先计算的分段索引做
+ *       整数分段线性插值, 每次查表为常数时间
+ */
+
+#include "stm32f10x.h"
+#include "calib.h"
+
+/* Flash存储格式 */
+typedef struct
+{
+    uint32_t magic;                         // CALIB_FLASH_MAGIC
+    uint32_t version;                       // CALIB_FLASH_VERSION
+    struct
+    {
+        int32_t count;                      // 校准点数
+        int32_t x[CALIB_MAX_POINTS];        // 标称值
+        int32_t y[CALIB_MAX_POINTS];        // 参考值
+    } channel[CALIB_CHANNELS];
+    uint32_t checksum;                      // 以上各字之和取反
+} Calib_StoreTypeDef;
+
+/* 运行时校准表 */
+static Calib_TableTypeDef calib_tables[CALIB_CHANNELS];
+
+/**
+ * @brief  预计算各段斜率和分段索引
+ * @note   相邻点间距不小于桶宽, 每个桶内至多一个断点, 查表时最多再比较一次
+ * @param  table: 校准表
+ * @retval 无
+ */
+static void Calib_Build(Calib_TableTypeDef *table)
+{
+    uint8_t seg = 0;
+    uint8_t i, b;
+    int32_t start;
+    
+    for (i = 0; i + 1 < table->count; i++)
+    {
+        table->slope_q16[i] = (int32_t)((((int64_t)(table->y[i + 1] - table->y[i])) << 16) /
+                                        (table->x[i + 1] - table->x[i]));
+    }
+    
+    /* 每桶记录起点所在分段, 首末段向外延伸 */
+    for (b = 0; b < CALIB_BUCKETS; b++)
+    {
+        start = (int32_t)b << CALIB_BUCKET_SHIFT;
+        while (seg + 2 < table->count && table->x[seg + 1] <= start)
+            seg++;
+        table->bucket[b] = seg;
+    }
+}
+
+/**
+ * @brief  从Flash加载校准表
+ * @note   Flash中无有效数据时各通道不校准
+ * @param  无
+ * @retval 0 - 已加载, 1 - Flash中无有效校准表
+ */
+uint8_t Calib_Init(void)
+{
+    const Calib_StoreTypeDef *store = (const Calib_StoreTypeDef *)CALIB_FLASH_ADDR;
+    const uint32_t *word = (const uint32_t *)CALIB_FLASH_ADDR;
+    uint32_t sum = 0;
+    uint16_t i;
+    uint8_t ch, k;
+    
+    for (ch = 0; ch < CALIB_CHANNELS; ch++)
+    {
+        calib_tables[ch].count = 0;
+        Calib_Build(&calib_tables[ch]);
+    }
+    
+    /* 校验标识、版本和校验和 */
+    if (store->magic != CALIB_FLASH_MAGIC || store->version != CALIB_FLASH_VERSION)
+        return 1;
+    for (i = 0; i < (sizeof(Calib_StoreTypeDef) / 4) - 1; i++)
+        sum += word[i];
+    if (store->checksum != ~sum)
+        return 1;
+    
+    for (ch = 0; ch < CALIB_CHANNELS; ch++)
+    {
+        if (store->channel[ch].count < 0 || store->channel[ch].count > CALIB_MAX_POINTS)
+            continue;
+        calib_tables[ch].count = (uint8_t)store->channel[ch].count;
+        for (k = 0; k < calib_tables[ch].count; k++)
+        {
+            calib_tables[ch].x[k] = store->channel[ch].x[k];
+            calib_tables[ch].y[k] = store->channel[ch].y[k];
+        }
+        Calib_Build(&calib_tables[ch]);
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief  添加校准点
+ * @note   在当前读数(标称值)处记录参考温度; 点按标称值排序插入,
+ *         标称值和参考值都须单调递增, 且与相邻点间距不小于CALIB_MIN_SPACING
+ * @param  channel: 通道序号(扫描序列中的位置)
+ * @param  nominal: 当前标称值(0.01单位)
+ * @param  reference: 参考值(0.01单位)
+ * @retval 0 - 成功, 1 - 参数无效、点过密、非单调或表已满
+ */
+uint8_t Calib_AddPoint(uint8_t channel, int32_t nominal, int32_t reference)
+{
+    Calib_TableTypeDef *table;
+    uint8_t pos, i;
+    
+    if (channel >= CALIB_CHANNELS)
+        return 1;
+    table = &calib_tables[channel];
+    if (table->count >= CALIB_MAX_POINTS)
+        return 1;
+    
+    /* 插入位置 */
+    for (pos = 0; pos < table->count && table->x[pos] < nominal; pos++)
+        ;
+    
+    /* 与相邻点的间距和单调性 */
+    if (pos > 0 && (nominal - table->x[pos - 1] < CALIB_MIN_SPACING || reference <= table->y[pos - 1]))
+        return 1;
+    if (pos < table->count && (table->x[pos] - nominal < CALIB_MIN_SPACING || reference >= table->y[pos]))
+        return 1;
+    
+    for (i = table->count; i > pos; i--)
+    {
+        table->x[i] = table->x[i - 1];
+        table->y[i] = table->y[i - 1];
+    }
+    table->x[pos] = nominal;
+    table->y[pos] = reference;
+    table->count++;
+    Calib_Build(table);
+    
+    return 0;
+}
+
+/**
+ * @brief  清除通道校准表
+ * @param  channel: 通道序号
+ * @retval 无
+ */
+void Calib_Clear(uint8_t channel)
+{
+    if (channel >= CALIB_CHANNELS)
+        return;
+    
+    calib_tables[channel].count = 0;
+    Calib_Build(&calib_tables[channel]);
+}
+
+/**
+ * @brief  校准表写入Flash
+ * @note   擦除一页约20ms, 期间CPU取指暂停, 中断延后响应; 仅在维护时调用
+ * @param  无
+ * @retval 0 - 成功, 1 - 擦写失败
+ */
+uint8_t Calib_Save(void)
+{
+    FLASH_Status status;
+    uint32_t address = CALIB_FLASH_ADDR;
+    uint32_t sum = 0;
+    uint32_t data;
+    uint8_t ch, k;
+    
+    FLASH_Unlock();
+    FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+    status = FLASH_ErasePage(CALIB_FLASH_ADDR);
+    
+    /* 按存储格式逐字写入, 同时累加校验和 */
+    if (status == FLASH_COMPLETE)
+    {
+        sum += CALIB_FLASH_MAGIC;
+        status = FLASH_ProgramWord(address, CALIB_FLASH_MAGIC);
+        address += 4;
+    }
+    if (status == FLASH_COMPLETE)
+    {
+        sum += CALIB_FLASH_VERSION;
+        status = FLASH_ProgramWord(address, CALIB_FLASH_VERSION);
+        address += 4;
+    }
+    for (ch = 0; ch < CALIB_CHANNELS && status == FLASH_COMPLETE; ch++)
+    {
+        data = calib_tables[ch].count;
+        sum += data;
+        status = FLASH_ProgramWord(address, data);
+        address += 4;
+        for (k = 0; k < CALIB_MAX_POINTS && status == FLASH_COMPLETE; k++)
+        {
+            data = (k < calib_tables[ch].count) ? (uint32_t)calib_tables[ch].x[k] : 0;
+            sum += data;
+            status = FLASH_ProgramWord(address, data);
+            address += 4;
+        }
+        for (k = 0; k < CALIB_MAX_POINTS && status == FLASH_COMPLETE; k++)
+        {
+            data = (k < calib_tables[ch].count) ? (uint32_t)calib_tables[ch].y[k] : 0;
+            sum += data;
+            status = FLASH_ProgramWord(address, data);
+            address += 4;
+        }
+    }
+    if (status == FLASH_COMPLETE)
+        status = FLASH_ProgramWord(address, ~sum);
+    
+    FLASH_Lock();
+    
+    return (status == FLASH_COMPLETE) ? 0 : 1;
+}
+
+/**
+ * @brief  标称值转换为校准值
+ * @note   常数时间: 桶索引取分段, 至多一次比较修正, 再做一次64位乘法插值;
+ *         1个点时仅修正零点, 无校准点时原样返回
+ * @param  channel: 通道序号
+ * @param  nominal: 标称值(0.01单位)
+ * @retval 校准值(0.01单位)
+ */
+int32_t Calib_Apply(uint8_t channel, int32_t nominal)
+{
+    const Calib_TableTypeDef *table;
+    int32_t b;
+    uint8_t seg;
+    
+    if (channel >= CALIB_CHANNELS)
+        return nominal;
+    table = &calib_tables[channel];
+    if (table->count == 0)
+        return nominal;
+    if (table->count == 1)
+        return nominal + table->y[0] - table->x[0];
+    
+    b = nominal >> CALIB_BUCKET_SHIFT;
+    if (b < 0)
+        b = 0;
+    if (b >= CALIB_BUCKETS)
+        b = CALIB_BUCKETS - 1;
+    
+    seg = table->bucket[b];
+    if (seg + 2 < table->count && nominal >= table->x[seg + 1])
+        seg++;
+    
+    return table->y[seg] + (int32_t)(((int64_t)(nominal - table->x[seg]) * table->slope_q16[seg] + 0x8000) >> 16);
+}
+
+/**
+ * @brief  校准值反算为标称值
+ * @note   用于把以真实温度给出的阈值换算到标称值空间, 仅在配置时调用
+ * @param  channel: 通道序号
+ * @param  value: 校准值(0.01单位)
+ * @retval 标称值(0.01单位)
+ */
+int32_t Calib_Invert(uint8_t channel, int32_t value)
+{
+    const Calib_TableTypeDef *table;
+    uint8_t seg;
+    
+    if (channel >= CALIB_CHANNELS)
+        return value;
+    table = &calib_tables[channel];
+    if (table->count == 0)
+        return value;
+    if (table->count == 1)
+        return value - table->y[0] + table->x[0];
+    
+    /* 参考值单调递增, 顺序查找所在分段, 首末段向外延伸 */
+    for (seg = 0; seg + 2 < table->count && value >= table->y[seg + 1]; seg++)
+        ;
+    
+    return table->x[seg] + (int32_t)(((int64_t)(value - table->y[seg]) * (table->x[seg + 1] - table->x[seg])) /
+                                     (table->y[seg + 1] - table->y[seg]));
+}
+
+/**
+ * @brief  获取通道校准表
+ * @param  channel: 通道序号
+ * @retval 校准表, 通道无效时返回0
+ */
+const Calib_TableTypeDef *Calib_GetTable(uint8_t channel)
+{
+    if (channel >= CALIB_CHANNELS)
+        return 0;
+    
+    return &calib_tables[channel];
+}
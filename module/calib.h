@@ -0,0 +1,44 @@
+/*
+ * 文件名: calib.h
+ * 描述: 传感器校准模块头文件
+ * 功能: 声明多点校准表、Flash存储和分段线性查表相关类型和函数
+ */
+
+#ifndef __CALIB_H
+#define __CALIB_H
+
+#include "stm32f10x.h"
+#include "adc.h"
+
+/* Flash存储参数: STM32F103C8最后一页(1KB), 工程链接范围已让出该页 */
+#define CALIB_FLASH_ADDR        0x0800FC00  // 校准表存储地址
+#define CALIB_FLASH_MAGIC       0x424C4143  // "CALB"
+#define CALIB_FLASH_VERSION     1           // 存储格式版本
+
+/* 校准表参数: 校准在换算后的标称值(0.01单位)上进行, 不受VDDA补偿影响 */
+#define CALIB_CHANNELS          ADC_MAX_CHANNELS    // 每个扫描通道一张表
+#define CALIB_MAX_POINTS        8           // 每通道最多校准点数
+#define CALIB_BUCKET_SHIFT      9           // 分段索引桶宽 2^9 = 512 (5.12°C)
+#define CALIB_BUCKETS           72          // 分段索引桶数, 覆盖0 ~ 36863
+#define CALIB_MIN_SPACING       (1 << CALIB_BUCKET_SHIFT)   // 相邻校准点最小间距, 保证每桶至多一个断点
+
+/* 单通道校准表 */
+typedef struct
+{
+    uint8_t count;                          // 校准点数, 0为不校准, 1为仅修正零点
+    int32_t x[CALIB_MAX_POINTS];            // 标称值(0.01单位), 严格递增
+    int32_t y[CALIB_MAX_POINTS];            // 参考值(0.01单位), 严格递增
+    int32_t slope_q16[CALIB_MAX_POINTS];    // 各段斜率 (y1-y0)/(x1-x0), Q16
+    uint8_t bucket[CALIB_BUCKETS];          // 各桶起点所在分段
+} Calib_TableTypeDef;
+
+/* 函数声明 */
+uint8_t Calib_Init(void);                   // 从Flash加载校准表
+uint8_t Calib_AddPoint(uint8_t channel, int32_t nominal, int32_t reference); // 添加校准点
+void Calib_Clear(uint8_t channel);          // 清除通道校准表
+uint8_t Calib_Save(void);                   // 校准表写入Flash
+int32_t Calib_Apply(uint8_t channel, int32_t nominal);    // 标称值 -> 校准值(常数时间)
+int32_t Calib_Invert(uint8_t channel, int32_t value);     // 校准值 -> 标称值(用于阈值换算)
+const Calib_TableTypeDef *Calib_GetTable(uint8_t channel); // 获取通道校准表
+
+#endif /* __CALIB_H */
@@ -0,0 +1,353 @@
+/*
+ * 文件名: capture.c
+ * 描述: 波形捕获模块
+ * 功能: 以ADC全速率循环保存预触发波形, 在电平/斜率/外部触发后冻结后触发采样,
+ *       再由主循环分块经串口发送, 不影响正常监测
+ */
+
+#include "stm32f10x.h"
+#include "capture.h"
+#include "adc.h"
+#include "usart.h"
+#include <stdio.h>
+
+/* 缓冲区容量须为2的幂, 环形下标用掩码回绕 */
+#define CAPTURE_INDEX_MASK  (CAPTURE_BUFFER_SIZE - 1)
+
+/**
+ * @brief  初始化捕获器
+ * @param  cap: 捕获器
+ * @param  channel: 捕获的帧内通道序号(与ADC数据块中的顺序一致)
+ * @retval 无
+ */
+void Capture_Init(Capture_TypeDef *cap, uint8_t channel)
+{
+    cap->state = CAPTURE_IDLE;
+    cap->channel = channel;
+    cap->index = 0;
+    cap->filled = 0;
+    cap->force = 0;
+    cap->gap = 0;
+    cap->decimation = 1;
+    cap->length = CAPTURE_BUFFER_SIZE;
+}
+
+/**
+ * @brief  布防
+ * @note   重新开始填充预触发缓冲区, 至少采满pre个采样后才响应触发;
+ *         正在发送的窗口会被放弃, 借出中的缓冲区须先归还
+ * @param  cap: 捕获器
+ * @param  mode: 触发方式 CAPTURE_TRIG_xxx
+ * @param  param: 电平触发为12位ADC值, 斜率触发为相邻采样差值(LSB), 外部触发忽略
+ * @param  pre: 预触发采样点数, 0 ~ 窗口长度 - 1
+ * @retval 0 - 成功, 1 - 参数无效或缓冲区借出中
+ */
+uint8_t Capture_Arm(Capture_TypeDef *cap, uint8_t mode, int32_t param, uint16_t pre)
+{
+    if (mode > CAPTURE_TRIG_EXTERNAL || pre >= cap->length)
+        return 1;
+    if ((mode == CAPTURE_TRIG_RISING || mode == CAPTURE_TRIG_FALLING) && (param < 0 || param > 4095))
+        return 1;
+    if (mode == CAPTURE_TRIG_SLOPE && param == 0)
+        return 1;
+    if (cap->state == CAPTURE_CLAIMED)
+        return 1;
+    
+    /* 先停止, 配置完成后再布防, 避免DMA中断看到中间状态 */
+    cap->state = CAPTURE_IDLE;
+    cap->mode = mode;
+    cap->param = param;
+    cap->pre = pre;
+    cap->index = 0;
+    cap->filled = 0;
+    cap->force = 0;
+    cap->gap = 0;
+    cap->dec_count = 0;
+    cap->dec_acc = 0;
+    cap->state = CAPTURE_ARMED;
+    
+    return 0;
+}
+
+/**
+ * @brief  标记采样流间断
+ * @note   在输入间断后的第一个数据块之前调用(DMA中断中). 预触发段要求连续,
+ *         布防状态下丢弃已填充的采样重新开始; 已触发则继续采集并标记窗口
+ * @param  cap: 捕获器
+ * @retval 无
+ */
+void Capture_MarkGap(Capture_TypeDef *cap)
+{
+    if (cap->state == CAPTURE_ARMED)
+    {
+        cap->index = 0;
+        cap->filled = 0;
+        cap->dec_count = 0;
+        cap->dec_acc = 0;
+    }
+    else if (cap->state == CAPTURE_TRIGGERED)
+    {
+        cap->gap = 1;
+    }
+}
+
+/**
+ * @brief  外部/手动触发
+ * @note   可在EXTI等中断中调用, 在下一个数据块的第一个采样处触发,
+ *         位置分辨率为一个数据块; 对任何触发方式均有效
+ * @param  cap: 捕获器
+ * @retval 0 - 已触发, 1 - 未布防
+ */
+uint8_t Capture_Trigger(Capture_TypeDef *cap)
+{
+    if (cap->state != CAPTURE_ARMED)
+        return 1;
+    
+    cap->force = 1;
+    
+    return 0;
+}
+
+/**
+ * @brief  输入一块采样数据
+ * @note   在ADC数据块回调(DMA中断)中调用, 每采样O(1); 抽取倍数大于1时先做块平均,
+ *         兼作抗混叠滤波, 触发条件作用于抽取后的采样
+ * @param  cap: 捕获器
+ * @param  data: 12位右对齐采样数据(数据块起始地址)
+ * @param  length: 帧数
+ * @param  stride: 每帧通道数
+ * @retval 无
+ */
+void Capture_PushBlock(Capture_TypeDef *cap, const uint16_t *data, uint16_t length, uint8_t stride)
+{
+    uint16_t x;
+    uint16_t i;
+    uint8_t trig;
+    
+    data += cap->channel;
+    for (i = 0; i < length; i++)
+    {
+        /* 空闲或窗口已冻结 */
+        if (cap->state != CAPTURE_ARMED && cap->state != CAPTURE_TRIGGERED)
+            break;
+    
+        x = data[i * stride];
+        if (cap->decimation > 1)
+        {
+            cap->dec_acc += x;
+            if (++cap->dec_count < cap->decimation)
+                continue;
+            x = (uint16_t)(cap->dec_acc / cap->decimation);
+            cap->dec_acc = 0;
+            cap->dec_count = 0;
+        }
+    
+        if (cap->state == CAPTURE_ARMED)
+        {
+            cap->buffer[cap->index] = x;
+            trig = 0;
+    
+            /* 预触发采样已满才检查触发条件 */
+            if (cap->filled >= cap->pre)
+            {
+                if (cap->force)
+                    trig = 1;
+                else if (cap->mode == CAPTURE_TRIG_RISING)
+                    trig = (cap->prev < cap->param && x >= cap->param);
+                else if (cap->mode == CAPTURE_TRIG_FALLING)
+                    trig = (cap->prev > cap->param && x <= cap->param);
+                else if (cap->mode == CAPTURE_TRIG_SLOPE)
+                    trig = (cap->param > 0) ? ((int32_t)x - cap->prev >= cap->param)
+                                            : ((int32_t)x - cap->prev <= cap->param);
+            }
+            if (cap->filled < CAPTURE_BUFFER_SIZE)
+                cap->filled++;
+            cap->prev = x;
+    
+            if (trig)
+            {
+                /* 触发点计为第一个后触发采样, 窗口从触发点前pre个采样开始 */
+                cap->force = 0;
+                cap->start = (cap->index - cap->pre) & CAPTURE_INDEX_MASK;
+                cap->post_remaining = cap->length - cap->pre - 1;
+                cap->state = (cap->post_remaining > 0) ? CAPTURE_TRIGGERED : CAPTURE_DONE;
+            }
+            cap->index = (cap->index + 1) & CAPTURE_INDEX_MASK;
+        }
+        else if (cap->state == CAPTURE_TRIGGERED)
+        {
+            cap->buffer[cap->index] = x;
+            cap->index = (cap->index + 1) & CAPTURE_INDEX_MASK;
+            if (--cap->post_remaining == 0)
+                cap->state = CAPTURE_DONE;
+        }
+    }
+}
+
+/**
+ * @brief  获取状态
+ * @param  cap: 捕获器
+ * @retval CAPTURE_IDLE / CAPTURE_ARMED / CAPTURE_TRIGGERED / CAPTURE_DONE / CAPTURE_SENDING / CAPTURE_CLAIMED
+ */
+uint8_t Capture_GetState(const Capture_TypeDef *cap)
+{
+    return cap->state;
+}
+
+/**
+ * @brief  分块发送已冻结窗口
+ * @note   主循环每次调用写入一行(CAPTURE_SEND_CHUNK个采样), 发送队列空间不足时跳过;
+ *         格式: "CAP BEGIN n=.. pre=.. rate=..Hz [gap]", 若干行逗号分隔的原始值, "CAP END";
+ *         窗口内有采样间断时首行带gap标记
+ * @param  cap: 捕获器
+ * @retval 1 - 仍有数据待发送, 0 - 无数据或已发送完毕
+ */
+uint8_t Capture_Stream(Capture_TypeDef *cap)
+{
+    char line[16 + CAPTURE_SEND_CHUNK * 6];
+    int length = 0;
+    uint16_t i;
+    
+    if (cap->state != CAPTURE_DONE && cap->state != CAPTURE_SENDING)
+        return 0;
+    
+    /* 发送队列空间不足时留到下一次, 避免整行被丢弃 */
+    if (USART_GetTxFree() < sizeof(line))
+        return 1;
+    
+    if (cap->state == CAPTURE_DONE)
+    {
+        sprintf(line, "CAP BEGIN n=%u pre=%u rate=%luHz%s\r\n", (unsigned int)cap->length,
+                (unsigned int)cap->pre, (unsigned long)Capture_GetRate(cap), cap->gap ? " gap" : "");
+        USART_SendString(USART1, line);
+        cap->send_count = 0;
+        cap->state = CAPTURE_SENDING;
+        return 1;
+    }
+    
+    if (cap->state != CAPTURE_SENDING)
+        return 0;
+    
+    for (i = 0; i < CAPTURE_SEND_CHUNK && cap->send_count < cap->length; i++)
+    {
+        length += sprintf(line + length, i ? ",%u" : "%u",
+                          (unsigned int)cap->buffer[(cap->start + cap->send_count) & CAPTURE_INDEX_MASK]);
+        cap->send_count++;
+    }
+    sprintf(line + length, "\r\n");
+    USART_SendString(USART1, line);
+    
+    if (cap->send_count >= cap->length)
+    {
+        USART_SendString(USART1, "CAP END\r\n");
+        cap->state = CAPTURE_IDLE;
+        return 0;
+    }
+    
+    return 1;
+}
+
+/**
+ * @brief  设置抽取倍数
+ * @note   捕获采样率 = ADC采样率 / decimation, 布防或采集中不可修改
+ * @param  cap: 捕获器
+ * @param  decimation: 抽取倍数, 1 ~ CAPTURE_DECIMATION_MAX
+ * @retval 0 - 成功, 1 - 参数无效或正在采集
+ */
+uint8_t Capture_SetDecimation(Capture_TypeDef *cap, uint16_t decimation)
+{
+    if (decimation == 0 || decimation > CAPTURE_DECIMATION_MAX)
+        return 1;
+    if (cap->state == CAPTURE_ARMED || cap->state == CAPTURE_TRIGGERED)
+        return 1;
+    
+    cap->decimation = decimation;
+    
+    return 0;
+}
+
+/**
+ * @brief  设置窗口长度
+ * @note   窗口采满即冻结, 只需要少量采样的用户(如FFT)不必等满整个缓冲区;
+ *         布防或采集中不可修改, Capture_Init恢复为CAPTURE_BUFFER_SIZE
+ * @param  cap: 捕获器
+ * @param  length: 窗口采样点数, 1 ~ CAPTURE_BUFFER_SIZE
+ * @retval 0 - 成功, 1 - 参数无效或正在采集
+ */
+uint8_t Capture_SetLength(Capture_TypeDef *cap, uint16_t length)
+{
+    if (length == 0 || length > CAPTURE_BUFFER_SIZE)
+        return 1;
+    if (cap->state == CAPTURE_ARMED || cap->state == CAPTURE_TRIGGERED)
+        return 1;
+    
+    cap->length = length;
+    
+    return 0;
+}
+
+/**
+ * @brief  获取捕获采样率
+ * @param  cap: 捕获器
+ * @retval 抽取后的采样率(Hz)
+ */
+uint32_t Capture_GetRate(const Capture_TypeDef *cap)
+{
+    return ADC_GetSampleRate() / cap->decimation;
+}
+
+/**
+ * @brief  反转缓冲区一段
+ * @param  buffer: 缓冲区
+ * @param  first: 起始位置
+ * @param  last: 结束位置(含)
+ * @retval 无
+ */
+static void Capture_Reverse(uint16_t *buffer, uint16_t first, uint16_t last)
+{
+    uint16_t t;
+    
+    while (first < last)
+    {
+        t = buffer[first];
+        buffer[first++] = buffer[last];
+        buffer[last--] = t;
+    }
+}
+
+/**
+ * @brief  借出已冻结窗口
+ * @note   原位三次反转把环形窗口旋转为buffer[0]起按时间顺序排列, 不占额外RAM;
+ *         借出期间不发送、不可布防, 调用者可把缓冲区用作CAPTURE_BUFFER_SIZE * 2字节的工作区,
+ *         用完须调用Capture_Release
+ * @param  cap: 捕获器
+ * @retval 缓冲区, 窗口未冻结时返回0
+ */
+uint16_t *Capture_Claim(Capture_TypeDef *cap)
+{
+    if (cap->state != CAPTURE_DONE)
+        return 0;
+    
+    if (cap->start != 0)
+    {
+        Capture_Reverse(cap->buffer, 0, cap->start - 1);
+        Capture_Reverse(cap->buffer, cap->start, CAPTURE_BUFFER_SIZE - 1);
+        Capture_Reverse(cap->buffer, 0, CAPTURE_BUFFER_SIZE - 1);
+        cap->start = 0;
+    }
+    cap->state = CAPTURE_CLAIMED;
+    
+    return cap->buffer;
+}
+
+/**
+ * @brief  归还借出的缓冲区
+ * @note   缓冲区内容已不是波形, 归还后回到空闲
+ * @param  cap: 捕获器
+ * @retval 无
+ */
+void Capture_Release(Capture_TypeDef *cap)
+{
+    if (cap->state == CAPTURE_CLAIMED)
+        cap->state = CAPTURE_IDLE;
+}
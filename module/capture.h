@@ -0,0 +1,69 @@
+/*
+ * 文件名: capture.h
+ * 描述: 波形捕获模块头文件
+ * 功能: 声明示波器式预触发/后触发波形捕获相关类型和函数
+ */
+
+#ifndef __CAPTURE_H
+#define __CAPTURE_H
+
+#include "stm32f10x.h"
+
+/* 捕获参数 */
+#define CAPTURE_BUFFER_SIZE     1024    // 捕获窗口采样点数(预触发 + 后触发)
+#define CAPTURE_PRE_DEFAULT     256     // 默认预触发采样点数
+#define CAPTURE_SEND_CHUNK      8       // 每次发送的采样点数(每行)
+#define CAPTURE_DECIMATION_MAX  256     // 最大抽取倍数
+
+/* 触发方式 */
+#define CAPTURE_TRIG_RISING     0       // 电平上升穿越: 上一点 < level <= 当前点
+#define CAPTURE_TRIG_FALLING    1       // 电平下降穿越: 上一点 > level >= 当前点
+#define CAPTURE_TRIG_SLOPE      2       // 斜率: 相邻两点差值 >= slope(slope<0时为 <= slope)
+#define CAPTURE_TRIG_EXTERNAL   3       // 外部触发: 仅由Capture_Trigger触发(如EXTI)
+
+/* 捕获状态 */
+#define CAPTURE_IDLE            0       // 空闲
+#define CAPTURE_ARMED           1       // 已布防, 循环填充预触发缓冲区
+#define CAPTURE_TRIGGERED       2       // 已触发, 采集后触发采样
+#define CAPTURE_DONE            3       // 窗口已冻结, 等待发送
+#define CAPTURE_SENDING         4       // 正在分块发送
+#define CAPTURE_CLAIMED         5       // 缓冲区已借出(如FFT原位计算), 不发送也不可布防
+
+/* 波形捕获器 */
+typedef struct
+{
+    uint16_t buffer[CAPTURE_BUFFER_SIZE];   // 环形采样缓冲区
+    uint16_t index;                 // 下一个写入位置
+    uint16_t filled;                // 布防后已写入采样数(饱和于缓冲区容量)
+    uint16_t pre;                   // 预触发采样点数
+    uint16_t length;                // 窗口采样点数(预触发 + 后触发), 不超过缓冲区容量
+    uint16_t post_remaining;        // 尚需采集的后触发采样点数
+    uint16_t start;                 // 冻结后窗口起始位置
+    uint16_t send_count;            // 已发送采样点数
+    int32_t param;                  // 触发参数: 电平(ADC值)或斜率(LSB/采样)
+    uint16_t prev;                  // 上一个采样
+    uint16_t decimation;            // 抽取倍数: 每decimation个采样取平均存为一点
+    uint16_t dec_count;             // 当前抽取窗口已累加采样数
+    uint32_t dec_acc;               // 当前抽取窗口累加和
+    uint8_t channel;                // 捕获的帧内通道序号
+    uint8_t mode;                   // 触发方式 CAPTURE_TRIG_xxx
+    volatile uint8_t state;         // 状态 CAPTURE_xxx
+    volatile uint8_t force;         // 外部/手动触发请求
+    uint8_t gap;                    // 1 - 后触发段内有采样间断(ADC后台校准)
+} Capture_TypeDef;
+
+/* 函数声明 */
+void Capture_Init(Capture_TypeDef *cap, uint8_t channel);   // 初始化捕获器
+uint8_t Capture_Arm(Capture_TypeDef *cap, uint8_t mode, int32_t param, uint16_t pre); // 布防
+uint8_t Capture_Trigger(Capture_TypeDef *cap);              // 外部/手动触发
+void Capture_PushBlock(Capture_TypeDef *cap, const uint16_t *data, uint16_t length, uint8_t stride); // 输入一块采样
+void Capture_MarkGap(Capture_TypeDef *cap);                 // 标记采样流间断
+uint8_t Capture_GetState(const Capture_TypeDef *cap);       // 获取状态
+uint8_t Capture_Stream(Capture_TypeDef *cap);               // 分块发送已冻结窗口
+uint8_t Capture_SetDecimation(Capture_TypeDef *cap, uint16_t decimation); // 设置抽取倍数
+uint8_t Capture_SetLength(Capture_TypeDef *cap, uint16_t length); // 设置窗口长度
+uint32_t Capture_GetRate(const Capture_TypeDef *cap);       // 获取捕获采样率(Hz)
+uint16_t *Capture_Claim(Capture_TypeDef *cap);              // 借出已冻结窗口, 按时间顺序排列
+void Capture_Release(Capture_TypeDef *cap);                 // 归还借出的缓冲区
+
+#endif /* __CAPTURE_H */
@@ -0,0 +1,117 @@
+/*
+ * 文件名: command.c
+ * 描述: 串口命令分发模块
+ * 功能: 从串口接收缓冲区按命令表解析定长命令帧, 操作码直接索引命令表O(1)分发,
+ *       在主循环中执行并统计每条命令的处理耗时
+ */
+
+#include "stm32f10x.h"
+#include "command.h"
+#include "usart.h"
+#include "systick.h"
+
+static const Command_TypeDef *command_table = 0;    // 命令表
+static Command_StatsTypeDef command_stats;          // 处理统计
+
+/**
+ * @brief  设置命令表
+ * @note   命令表一般为const数组, 以操作码为下标(C99指定初始化), 未列出的项为0
+ * @param  table: 命令表, COMMAND_OPCODE_COUNT项
+ * @retval 无
+ */
+void Command_Init(const Command_TypeDef *table)
+{
+    command_table = table;
+    command_stats.count = 0;
+    command_stats.invalid = 0;
+    command_stats.timeouts = 0;
+    command_stats.cycles_last = 0;
+    command_stats.cycles_max = 0;
+    command_stats.opcode_max = 0;
+}
+
+/**
+ * @brief  丢弃当前帧的剩余部分并回复无效指令
+ * @note   帧以线路空闲分隔, 错位的字节只影响所在的一帧, 下一帧重新从操作码开始解析
+ * @param  remain: 当前帧剩余字节数
+ * @retval 无
+ */
+static void Command_Reject(uint16_t remain)
+{
+    USART_RxConsume(remain);
+    command_stats.invalid++;
+    USART_SendString(USART1, "invalid instruction.\r\n");
+}
+
+/**
+ * @brief  从串口接收缓冲区取出并执行命令
+ * @note   在主循环中调用, 每次最多执行COMMAND_PER_POLL条. 一帧(线路空闲分隔)内可连续
+ *         多条命令; 未定义的操作码或帧内剩余字节不足一条命令时丢弃该帧其余部分.
+ *         帧尚未结束时等待参数收齐, 线路停止超过COMMAND_FRAME_TIMEOUT仍无空闲边界时丢弃
+ * @param  无
+ * @retval 本次执行的命令数
+ */
+uint8_t Command_Poll(void)
+{
+    const Command_TypeDef *command;
+    uint8_t args[COMMAND_ARGS_MAX];
+    uint16_t available;
+    uint16_t remain;
+    uint32_t start;
+    uint8_t opcode;
+    uint8_t done = 0;
+    uint8_t i;
+    
+    while (done < COMMAND_PER_POLL && (available = USART_RxAvailable()) > 0)
+    {
+        remain = USART_RxFrameRemain();
+        opcode = USART_RxAt(0);
+        command = (opcode < COMMAND_OPCODE_COUNT) ? &command_table[opcode] : 0;
+        
+        /* 帧尚未结束: 出错时等到帧结束再整帧丢弃, 参数未收齐时等待 */
+        if (remain == 0 && (command == 0 || command->handler == 0 || available <= command->args))
+        {
+            if (GetSysTime_ms() - USART_GetRxTime() > COMMAND_FRAME_TIMEOUT)
+            {
+                USART_RxConsume(available);
+                command_stats.timeouts++;
+            }
+            break;
+        }
+        
+        if (command == 0 || command->handler == 0 || (remain != 0 && remain <= command->args))
+        {
+            Command_Reject(remain);
+            continue;
+        }
+        
+        for (i = 0; i < command->args; i++)
+        {
+            args[i] = USART_RxAt(1 + i);
+        }
+        USART_RxConsume(1 + command->args);
+        
+        start = GetCycleCount();
+        command->handler(opcode, args);
+        command_stats.cycles_last = GetCycleCount() - start;
+        if (command_stats.cycles_last > command_stats.cycles_max)
+        {
+            command_stats.cycles_max = command_stats.cycles_last;
+            command_stats.opcode_max = opcode;
+        }
+        command_stats.count++;
+        done++;
+    }
+    
+    return done;
+}
+
+/**
+ * @brief  获取命令处理统计
+ * @param  无
+ * @retval 统计数据
+ */
+const Command_StatsTypeDef *Command_GetStats(void)
+{
+    return &command_stats;
+}
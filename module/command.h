@@ -0,0 +1,44 @@
+/*
+ * 文件名: command.h
+ * 描述: 串口命令分发模块头文件
+ * 功能: 声明按操作码索引的命令表、帧解析和处理耗时统计
+ */
+
+#ifndef __COMMAND_H
+#define __COMMAND_H
+
+#include "stm32f10x.h"
+
+/* 命令帧: 操作码(1字节) + 命令表规定的定长参数; 串口线路空闲分隔的一帧内可连续多条命令 */
+#define COMMAND_OPCODE_COUNT    0x30    // 操作码范围 0x00 ~ 0x2F, 命令表按操作码直接索引
+#define COMMAND_ARGS_MAX        4       // 最多参数字节数
+#define COMMAND_FRAME_TIMEOUT   100     // 线路停止超过该值(ms)仍无空闲边界的数据被丢弃(正常由空闲中断分帧)
+#define COMMAND_PER_POLL        4       // 每次轮询最多处理的命令数, 限制单次主循环的处理时间
+
+/* 命令处理函数: opcode为收到的操作码(多个操作码可共用一个处理函数), args为定长参数 */
+typedef void (*Command_Handler)(uint8_t opcode, const uint8_t *args);
+
+/* 命令表项, handler为0表示未定义的操作码 */
+typedef struct
+{
+    Command_Handler handler;    // 处理函数
+    uint8_t args;               // 参数字节数, 0 ~ COMMAND_ARGS_MAX
+} Command_TypeDef;
+
+/* 命令处理统计 */
+typedef struct
+{
+    uint32_t count;             // 已执行的命令数
+    uint32_t invalid;           // 未定义的操作码数
+    uint32_t timeouts;          // 超时丢弃的不完整帧数
+    uint32_t cycles_last;       // 最近一条命令的处理CPU周期数
+    uint32_t cycles_max;        // 单条命令处理CPU周期数峰值
+    uint8_t opcode_max;         // 峰值对应的操作码
+} Command_StatsTypeDef;
+
+/* 函数声明 */
+void Command_Init(const Command_TypeDef *table);    // 设置命令表(COMMAND_OPCODE_COUNT项)
+uint8_t Command_Poll(void);                         // 从串口接收缓冲区取出并执行命令
+const Command_StatsTypeDef *Command_GetStats(void); // 获取命令处理统计
+
+#endif /* __COMMAND_H */
@@ -0,0 +1,196 @@
+/*
+ * 文件名: fft.c
+ * 描述: 定点FFT模块
+ * 功能: 在调用者提供的缓冲区上原位完成去直流、Hann加窗、Q15基2 FFT和幅度谱计算,
+ *       不额外占用RAM, 用于现场分析噪声频谱
+ */
+
+#include "stm32f10x.h"
+#include "fft.h"
+#include "filter.h"
+
+/**
+ * @brief  原位把实数采样转为复数Q15序列
+ * @note   输入为data[0 ~ N-1]中的12位ADC值; 去除均值后左移3位到Q15,
+ *         乘Hann窗抑制频谱泄漏, 再从后向前展开为实部/虚部交错存放(共2N个int16)
+ * @param  data: 数据缓冲区, 容量不小于2N
+ * @param  log2n: log2(N), FFT_LOG2N_MIN ~ FFT_LOG2N_MAX
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t FFT_PrepareReal(int16_t *data, uint8_t log2n)
+{
+    uint16_t n = 1u << log2n;
+    uint16_t step;
+    int32_t sum = 0, mean, x, window;
+    int16_t k;
+    
+    if (data == 0 || log2n < FFT_LOG2N_MIN || log2n > FFT_LOG2N_MAX)
+        return 1;
+    
+    for (k = 0; k < n; k++)
+        sum += data[k];
+    mean = sum >> log2n;
+    
+    /* 第k点写入2k和2k+1, 从后向前处理不会覆盖尚未读取的采样 */
+    step = (uint16_t)(65536u >> log2n);
+    for (k = n - 1; k >= 0; k--)
+    {
+        x = (data[k] - mean) << 3;
+        window = (32767 - Filter_SinQ15((uint16_t)(k * step + 16384))) >> 1;
+        data[2 * k] = (int16_t)((x * window) >> 15);
+        data[2 * k + 1] = 0;
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief  原位基2按时间抽取FFT
+ * @note   每级蝶形结果右移1位防止溢出, 输出为 X[k] / N; 旋转因子由正弦表插值得到
+ * @param  data: 实部/虚部交错的复数Q15序列, 共2N个int16
+ * @param  log2n: log2(N), FFT_LOG2N_MIN ~ FFT_LOG2N_MAX
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t FFT_Transform(int16_t *data, uint8_t log2n)
+{
+    uint16_t n = 1u << log2n;
+    uint16_t i, j, k, bit, len, half;
+    uint16_t phase, phase_step;
+    int32_t wr, wi, tr, ti, xr, xi;
+    int16_t t;
+    
+    if (data == 0 || log2n < FFT_LOG2N_MIN || log2n > FFT_LOG2N_MAX)
+        return 1;
+    
+    /* 位反序重排 */
+    for (i = 1, j = 0; i < n; i++)
+    {
+        for (bit = n >> 1; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+        if (i < j)
+        {
+            t = data[2 * i]; data[2 * i] = data[2 * j]; data[2 * j] = t;
+            t = data[2 * i + 1]; data[2 * i + 1] = data[2 * j + 1]; data[2 * j + 1] = t;
+        }
+    }
+    
+    /* 逐级蝶形运算, W = exp(-j * 2pi * k / len) */
+    for (len = 2; len <= n; len <<= 1)
+    {
+        half = len >> 1;
+        phase_step = (uint16_t)(65536u / len);
+        for (k = 0, phase = 0; k < half; k++, phase += phase_step)
+        {
+            wr = Filter_SinQ15((uint16_t)(phase + 16384));
+            wi = -Filter_SinQ15(phase);
+            for (i = k; i < n; i += len)
+            {
+                j = i + half;
+                tr = (wr * data[2 * j] - wi * data[2 * j + 1]) >> 15;
+                ti = (wr * data[2 * j + 1] + wi * data[2 * j]) >> 15;
+                xr = data[2 * i];
+                xi = data[2 * i + 1];
+                data[2 * j] = (int16_t)((xr - tr) >> 1);
+                data[2 * j + 1] = (int16_t)((xi - ti) >> 1);
+                data[2 * i] = (int16_t)((xr + tr) >> 1);
+                data[2 * i + 1] = (int16_t)((xi + ti) >> 1);
+            }
+        }
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief  整数平方根
+ * @param  x: 输入
+ * @retval floor(sqrt(x))
+ */
+static uint16_t FFT_Sqrt(uint32_t x)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+    
+    while (bit > x)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (x >= result + bit)
+        {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    
+    return (uint16_t)result;
+}
+
+/**
+ * @brief  原位计算幅度谱
+ * @note   实数输入的频谱共轭对称, 只计算0 ~ N/2频点; 第k点幅度写入((uint16_t *)data)[k],
+ *         k <= 2k, 顺序处理不会覆盖未读数据
+ * @param  data: FFT_Transform输出
+ * @param  log2n: log2(N)
+ * @retval 频点数 N/2 + 1
+ */
+uint16_t FFT_Magnitude(int16_t *data, uint8_t log2n)
+{
+    uint16_t *magnitude = (uint16_t *)data;
+    uint16_t bins = (1u << (log2n - 1)) + 1;
+    int32_t re, im;
+    uint16_t k;
+    
+    for (k = 0; k < bins; k++)
+    {
+        re = data[2 * k];
+        im = data[2 * k + 1];
+        magnitude[k] = FFT_Sqrt((uint32_t)(re * re) + (uint32_t)(im * im));
+    }
+    
+    return bins;
+}
+
+/**
+ * @brief  查找幅度最大的若干局部峰值
+ * @note   跳过直流频点, 结果按幅度降序排列
+ * @param  magnitude: 幅度谱
+ * @param  bins: 频点数
+ * @param  peaks: 峰值输出
+ * @param  count: 最多峰值数, 1 ~ FFT_PEAKS_MAX
+ * @retval 找到的峰值数
+ */
+uint8_t FFT_FindPeaks(const uint16_t *magnitude, uint16_t bins, FFT_PeakTypeDef *peaks, uint8_t count)
+{
+    uint8_t found = 0;
+    uint8_t pos;
+    uint16_t k;
+    
+    if (count == 0)
+        return 0;
+    if (count > FFT_PEAKS_MAX)
+        count = FFT_PEAKS_MAX;
+    
+    for (k = 1; k + 1 < bins; k++)
+    {
+        if (magnitude[k] <= magnitude[k - 1] || magnitude[k] < magnitude[k + 1])
+            continue;
+    
+        /* 按幅度插入有序表, 表满时丢弃最小值 */
+        if (found == count && magnitude[k] <= peaks[found - 1].magnitude)
+            continue;
+        if (found < count)
+            found++;
+        for (pos = found - 1; pos > 0 && peaks[pos - 1].magnitude < magnitude[k]; pos--)
+            peaks[pos] = peaks[pos - 1];
+        peaks[pos].bin = k;
+        peaks[pos].magnitude = magnitude[k];
+    }
+    
+    return found;
+}
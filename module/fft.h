@@ -0,0 +1,30 @@
+/*
+ * 文件名: fft.h
+ * 描述: 定点FFT模块头文件
+ * 功能: 声明Q15基2 FFT、幅度谱和峰值查找相关类型和函数
+ */
+
+#ifndef __FFT_H
+#define __FFT_H
+
+#include "stm32f10x.h"
+
+/* FFT参数 */
+#define FFT_LOG2N_MIN       8           // 最小点数 256
+#define FFT_LOG2N_MAX       9           // 最大点数 512, 复数Q15数据占2KB, 与捕获缓冲区相同
+#define FFT_PEAKS_MAX       8           // 最多查找峰值数
+
+/* 频谱峰值 */
+typedef struct
+{
+    uint16_t bin;                       // 频点序号, 频率 = bin * 采样率 / N
+    uint16_t magnitude;                 // 幅度
+} FFT_PeakTypeDef;
+
+/* 函数声明 */
+uint8_t FFT_PrepareReal(int16_t *data, uint8_t log2n);     // 原位把N个12位实数采样转为加窗的复数Q15序列
+uint8_t FFT_Transform(int16_t *data, uint8_t log2n);       // 原位基2 FFT, 每级缩放1/2
+uint16_t FFT_Magnitude(int16_t *data, uint8_t log2n);      // 原位计算0 ~ N/2频点幅度, 返回频点数
+uint8_t FFT_FindPeaks(const uint16_t *magnitude, uint16_t bins, FFT_PeakTypeDef *peaks, uint8_t count); // 查找幅度最大的若干局部峰值
+
+#endif /* __FFT_H */
@@ -0,0 +1,479 @@
+/*
+ * 文件名: filter.c
+ * 描述: 定点数字滤波模块
+ * 功能: 提供整数/Q15滤波级(滑动平均、滑动中值、一阶IIR、FIR), 可按通道串联成滤波链,
+ *       并统计每级每个采样的CPU周期数, 便于评估能否放入采样中断
+ */
+
+#include "stm32f10x.h"
+#include "filter.h"
+#include "systick.h"
+
+/**
+ * @brief  清零滤波级的周期统计
+ * @param  stage: 滤波级
+ * @retval 无
+ */
+static void Filter_ResetStats(Filter_StageTypeDef *stage)
+{
+    stage->cycles_acc = 0;
+    stage->samples = 0;
+    stage->cycles_per_sample = 0;
+    stage->cycles_max = 0;
+}
+
+/**
+ * @brief  初始化滑动平均级
+ * @note   维护运行和, 每个采样只做一次加减和一次除法, 与窗口长度无关
+ * @param  stage: 滤波级
+ * @param  length: 窗口长度, 1 ~ FILTER_BOXCAR_MAX
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Filter_BoxcarInit(Filter_StageTypeDef *stage, uint8_t length)
+{
+    if (stage == 0 || length == 0 || length > FILTER_BOXCAR_MAX)
+        return 1;
+    
+    stage->type = FILTER_TYPE_BOXCAR;
+    stage->u.boxcar.sum = 0;
+    stage->u.boxcar.length = length;
+    stage->u.boxcar.index = 0;
+    stage->u.boxcar.count = 0;
+    Filter_ResetStats(stage);
+    
+    return 0;
+}
+
+/**
+ * @brief  初始化滑动中值级
+ * @note   维护一份有序窗口, 每个采样删除最旧值并插入新值, O(N); 可剔除孤立尖峰
+ * @param  stage: 滤波级
+ * @param  length: 窗口长度, 3 ~ FILTER_MEDIAN_MAX且为奇数
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Filter_MedianInit(Filter_StageTypeDef *stage, uint8_t length)
+{
+    if (stage == 0 || length < 3 || length > FILTER_MEDIAN_MAX || (length & 1) == 0)
+        return 1;
+    
+    stage->type = FILTER_TYPE_MEDIAN;
+    stage->u.median.length = length;
+    stage->u.median.index = 0;
+    stage->u.median.count = 0;
+    Filter_ResetStats(stage);
+    
+    return 0;
+}
+
+/**
+ * @brief  初始化一阶IIR级
+ * @note   y += alpha * (x - y), 时间常数约 1/alpha 个采样; 第一个采样直接作为初值
+ * @param  stage: 滤波级
+ * @param  alpha_q15: 系数, Q15, 1 ~ 32767
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Filter_IIRInit(Filter_StageTypeDef *stage, int16_t alpha_q15)
+{
+    if (stage == 0 || alpha_q15 <= 0)
+        return 1;
+    
+    stage->type = FILTER_TYPE_IIR;
+    stage->u.iir.state = 0;
+    stage->u.iir.alpha = alpha_q15;
+    stage->u.iir.primed = 0;
+    Filter_ResetStats(stage);
+    
+    return 0;
+}
+
+/**
+ * @brief  初始化FIR级
+ * @note   系数拷贝到滤波级内, 调用后可释放原数组; 直流增益为系数和/32768
+ * @param  stage: 滤波级
+ * @param  coeffs: 系数数组, Q15
+ * @param  taps: 阶数, 1 ~ FILTER_FIR_MAX_TAPS
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Filter_FIRInit(Filter_StageTypeDef *stage, const int16_t *coeffs, uint8_t taps)
+{
+    uint8_t i;
+    
+    if (stage == 0 || coeffs == 0 || taps == 0 || taps > FILTER_FIR_MAX_TAPS)
+        return 1;
+    
+    stage->type = FILTER_TYPE_FIR;
+    for (i = 0; i < taps; i++)
+    {
+        stage->u.fir.coeffs[i] = coeffs[i];
+        stage->u.fir.history[i] = 0;
+    }
+    stage->u.fir.taps = taps;
+    stage->u.fir.index = 0;
+    Filter_ResetStats(stage);
+    
+    return 0;
+}
+
+/**
+ * @brief  初始化超前补偿级
+ * @note   用 (tau*s + 1) / (tau/G*s + 1) 抵消传感器一阶热滞后 1 / (tau*s + 1), 由输出估计被测物真实温度;
+ *         分解为 y = LP + G * (x - LP), LP为时间常数tau/G的一阶低通; 高频噪声放大G倍,
+ *         G越大补偿越完整、噪声越大; tau/G小于FILTER_LEAD_MIN_SAMPLES个采样周期时G自动减小,
+ *         减到1即不补偿(返回2); tau_ms为0时不补偿
+ * @param  stage: 滤波级
+ * @param  tau_ms: 传感器时间常数(ms)
+ * @param  rate_mhz: 输入采样率(mHz), 采样率可调时按实际值重新初始化
+ * @param  gain: 高频增益G, 1 ~ FILTER_LEAD_GAIN_MAX
+ * @retval 0 - 成功, 1 - 参数无效, 2 - tau不足FILTER_LEAD_MIN_SAMPLES个采样, 不补偿
+ */
+uint8_t Filter_LeadInit(Filter_StageTypeDef *stage, uint32_t tau_ms, uint32_t rate_mhz, uint8_t gain)
+{
+    uint32_t gain_q8 = (uint32_t)gain << 8;
+    uint32_t tau_samples_q8;
+    
+    if (stage == 0 || rate_mhz == 0 || gain == 0 || gain > FILTER_LEAD_GAIN_MAX)
+        return 1;
+    
+    /* 以采样数计的tau, Q8; 低通时间常数 tau/G 不小于FILTER_LEAD_MIN_SAMPLES个采样周期,
+     * 系数 alpha = G / tau(采样) 因而不超过0.5, Q15不会溢出 */
+    tau_samples_q8 = (uint32_t)(((uint64_t)tau_ms * rate_mhz << 8) / 1000000);
+    if (gain_q8 > tau_samples_q8 / FILTER_LEAD_MIN_SAMPLES)
+        gain_q8 = tau_samples_q8 / FILTER_LEAD_MIN_SAMPLES;
+    
+    stage->type = FILTER_TYPE_LEAD;
+    stage->u.lead.state = 0;
+    stage->u.lead.primed = 0;
+    Filter_ResetStats(stage);
+    if (gain_q8 <= 256)
+    {
+        /* 不补偿: G = 1时 y = x */
+        stage->u.lead.gain = 256;
+        stage->u.lead.alpha = 32767;
+    
+        return (tau_ms == 0) ? 0 : 2;
+    }
+    
+    stage->u.lead.gain = (uint16_t)gain_q8;
+    stage->u.lead.alpha = (int16_t)(((uint64_t)gain_q8 << 15) / tau_samples_q8);
+    
+    return 0;
+}
+
+/**
+ * @brief  滑动平均处理一个采样
+ * @param  f: 滑动平均状态
+ * @param  x: 输入
+ * @retval 窗口均值(未填满时为已有采样均值)
+ */
+static int32_t Filter_BoxcarProcess(Filter_BoxcarTypeDef *f, int32_t x)
+{
+    if (f->count < f->length)
+        f->count++;
+    else
+        f->sum -= f->buffer[f->index];
+    
+    f->buffer[f->index] = x;
+    f->sum += x;
+    if (++f->index >= f->length)
+        f->index = 0;
+    
+    return f->sum / f->count;
+}
+
+/**
+ * @brief  滑动中值处理一个采样
+ * @param  f: 滑动中值状态
+ * @param  x: 输入
+ * @retval 窗口中值(未填满时为已有采样中值)
+ */
+static int32_t Filter_MedianProcess(Filter_MedianTypeDef *f, int32_t x)
+{
+    uint8_t n = f->count;
+    uint8_t i;
+    
+    /* 窗口已满: 从有序表中删除最旧的采样 */
+    if (n == f->length)
+    {
+        int32_t old = f->buffer[f->index];
+        
+        for (i = 0; f->sorted[i] != old; i++)
+            ;
+        for (n--; i < n; i++)
+            f->sorted[i] = f->sorted[i + 1];
+    }
+    
+    /* 插入排序: 比x大的元素后移一位 */
+    for (i = n; i > 0 && f->sorted[i - 1] > x; i--)
+        f->sorted[i] = f->sorted[i - 1];
+    f->sorted[i] = x;
+    n++;
+    
+    f->count = n;
+    f->buffer[f->index] = x;
+    if (++f->index >= f->length)
+        f->index = 0;
+    
+    return f->sorted[n / 2];
+}
+
+/**
+ * @brief  一阶IIR处理一个采样
+ * @note   状态扩展8位小数, 避免小alpha时截断误差使输出停滞
+ * @param  f: IIR状态
+ * @param  x: 输入
+ * @retval 滤波输出
+ */
+static int32_t Filter_IIRProcess(Filter_IIRTypeDef *f, int32_t x)
+{
+    int32_t x8 = x * 256;
+    
+    if (!f->primed)
+    {
+        f->state = x8;
+        f->primed = 1;
+    }
+    else
+    {
+        /* 32x32->64位乘法(SMULL) */
+        f->state += (int32_t)(((int64_t)(x8 - f->state) * f->alpha) >> 15);
+    }
+    
+    return (f->state + 128) >> 8;
+}
+
+/**
+ * @brief  FIR处理一个采样
+ * @param  f: FIR状态
+ * @param  x: 输入
+ * @retval 滤波输出, sum(coeffs[k] * x[n-k]) >> 15
+ */
+static int32_t Filter_FIRProcess(Filter_FIRTypeDef *f, int32_t x)
+{
+    int64_t acc = 0;
+    uint8_t i, k;
+    
+    if (++f->index >= f->taps)
+        f->index = 0;
+    f->history[f->index] = x;
+    
+    /* 乘累加(SMLAL), k从最新采样向前 */
+    k = f->index;
+    for (i = 0; i < f->taps; i++)
+    {
+        acc += (int32_t)f->coeffs[i] * (int64_t)f->history[k];
+        k = (k == 0) ? (f->taps - 1) : (k - 1);
+    }
+    
+    return (int32_t)((acc + (1 << 14)) >> 15);
+}
+
+/**
+ * @brief  超前补偿处理一个采样
+ * @note   输出可能超出输入范围(阶跃时过冲至G倍), 由调用者限幅
+ * @param  f: 超前补偿状态
+ * @param  x: 输入
+ * @retval 补偿输出
+ */
+static int32_t Filter_LeadProcess(Filter_LeadTypeDef *f, int32_t x)
+{
+    int32_t x8 = x * 256;
+    
+    if (!f->primed)
+    {
+        f->state = x8;
+        f->primed = 1;
+    }
+    else
+    {
+        f->state += (int32_t)(((int64_t)(x8 - f->state) * f->alpha) >> 15);
+    }
+    
+    return (int32_t)((f->state + (((int64_t)(x8 - f->state) * f->gain) >> 8) + 128) >> 8);
+}
+
+/**
+ * @brief  单级处理一个采样
+ * @param  stage: 滤波级
+ * @param  x: 输入
+ * @retval 滤波输出, 未初始化的级原样输出
+ */
+int32_t Filter_Process(Filter_StageTypeDef *stage, int32_t x)
+{
+    switch (stage->type)
+    {
+        case FILTER_TYPE_BOXCAR:
+            return Filter_BoxcarProcess(&stage->u.boxcar, x);
+        case FILTER_TYPE_MEDIAN:
+            return Filter_MedianProcess(&stage->u.median, x);
+        case FILTER_TYPE_IIR:
+            return Filter_IIRProcess(&stage->u.iir, x);
+        case FILTER_TYPE_FIR:
+            return Filter_FIRProcess(&stage->u.fir, x);
+        case FILTER_TYPE_LEAD:
+            return Filter_LeadProcess(&stage->u.lead, x);
+        default:
+            return x;
+    }
+}
+
+/**
+ * @brief  初始化空滤波链
+ * @param  chain: 滤波链
+ * @retval 无
+ */
+void Filter_ChainInit(Filter_ChainTypeDef *chain)
+{
+    chain->count = 0;
+}
+
+/**
+ * @brief  向滤波链末尾追加一级
+ * @note   返回的级须再用Filter_xxxInit初始化, 例如
+ *         Filter_MedianInit(Filter_ChainAddStage(&chain), 5);
+ * @param  chain: 滤波链
+ * @retval 新增的滤波级, 链已满时返回0
+ */
+Filter_StageTypeDef *Filter_ChainAddStage(Filter_ChainTypeDef *chain)
+{
+    Filter_StageTypeDef *stage;
+    
+    if (chain->count >= FILTER_CHAIN_MAX_STAGES)
+        return 0;
+    
+    stage = &chain->stage[chain->count++];
+    stage->type = 0;
+    Filter_ResetStats(stage);
+    
+    return stage;
+}
+
+/**
+ * @brief  滤波链处理一个采样
+ * @note   可在采样中断中调用; 每级单独计时, 每FILTER_STAT_SAMPLES个采样
+ *         更新一次每采样周期数(含读取DWT计数器的几个周期开销)
+ * @param  chain: 滤波链
+ * @param  x: 输入
+ * @retval 最后一级输出
+ */
+int32_t Filter_ChainProcess(Filter_ChainTypeDef *chain, int32_t x)
+{
+    Filter_StageTypeDef *stage;
+    uint32_t start;
+    uint8_t i;
+    
+    for (i = 0; i < chain->count; i++)
+    {
+        stage = &chain->stage[i];
+    
+        start = GetCycleCount();
+        x = Filter_Process(stage, x);
+        stage->cycles_acc += GetCycleCount() - start;
+    
+        /* 统计窗口满, 按2的幂移位求平均 */
+        if (++stage->samples >= FILTER_STAT_SAMPLES)
+        {
+            stage->cycles_per_sample = stage->cycles_acc >> FILTER_STAT_SHIFT;
+            if (stage->cycles_per_sample > stage->cycles_max)
+                stage->cycles_max = stage->cycles_per_sample;
+            stage->cycles_acc = 0;
+            stage->samples = 0;
+        }
+    }
+    
+    return x;
+}
+
+/* 正弦四分之一周期表, Q15, 64段 */
+static const int16_t filter_sin_table[65] =
+{
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+/**
+ * @brief  定点正弦
+ * @note   四分之一周期查表加线性插值, 误差约1e-4(-80dB)
+ * @param  phase: 相位, 65536对应一个周期
+ * @retval sin(phase), Q15
+ */
+int16_t Filter_SinQ15(uint16_t phase)
+{
+    uint16_t index = (phase >> 8) & 0x3F;
+    int32_t frac = phase & 0xFF;
+    int32_t a, b;
+    
+    /* 第2、4象限镜像 */
+    if (phase & 0x4000)
+    {
+        index = 64 - index;
+        a = filter_sin_table[index];
+        b = filter_sin_table[index - 1];
+    }
+    else
+    {
+        a = filter_sin_table[index];
+        b = filter_sin_table[index + 1];
+    }
+    a += ((b - a) * frac) >> 8;
+    
+    /* 后半周期取反 */
+    return (int16_t)((phase & 0x8000) ? -a : a);
+}
+
+/**
+ * @brief  整数以2为底的对数
+ * @note   逐位平方求小数部分
+ * @param  x: 输入, 大于0
+ * @retval log2(x), Q16
+ */
+static int32_t Filter_Log2Q16(uint32_t x)
+{
+    uint64_t m;
+    int32_t result;
+    uint8_t msb = 31;
+    int8_t bit;
+    
+    while (msb > 0 && !(x & (1u << msb)))
+        msb--;
+    result = (int32_t)msb << 16;
+    
+    /* 归一化到[1, 2), Q31 */
+    m = (uint64_t)x << (31 - msb);
+    for (bit = 15; bit >= 0; bit--)
+    {
+        m = (m * m) >> 31;
+        if (m >= ((uint64_t)1 << 32))
+        {
+            m >>= 1;
+            result |= (int32_t)1 << bit;
+        }
+    }
+    
+    return result;
+}
+
+/**
+ * @brief  幅度比换算为分贝
+ * @note   20*log10(num/den) = 6.0206 * log2(num/den)
+ * @param  num: 分子幅度, 大于0
+ * @param  den: 分母幅度, 大于0
+ * @retval 分贝值(0.01dB)
+ */
+int32_t Filter_RatioToCentiDb(uint32_t num, uint32_t den)
+{
+    int64_t log2_ratio;
+    
+    if (num == 0 || den == 0)
+        return 0;
+    
+    log2_ratio = (int64_t)Filter_Log2Q16(num) - Filter_Log2Q16(den);
+    
+    return (int32_t)((log2_ratio * 60206) / (100 << 16));
+}
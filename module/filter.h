@@ -0,0 +1,113 @@
+/*
+ * 文件名: filter.h
+ * 描述: 定点数字滤波模块头文件
+ * 功能: 声明滑动平均、滑动中值、一阶IIR、FIR滤波级及滤波链
+ */
+
+#ifndef __FILTER_H
+#define __FILTER_H
+
+#include "stm32f10x.h"
+
+/* 编译期容量 */
+#define FILTER_BOXCAR_MAX       32      // 滑动平均最大窗口
+#define FILTER_MEDIAN_MAX       9       // 滑动中值最大窗口(奇数)
+#define FILTER_FIR_MAX_TAPS     16      // FIR最大阶数
+#define FILTER_CHAIN_MAX_STAGES 4       // 每条滤波链最多级数
+#define FILTER_STAT_SHIFT       8       // 统计窗口采样点数的log2
+#define FILTER_STAT_SAMPLES     (1u << FILTER_STAT_SHIFT)   // 每统计一次周期数的采样点数
+#define FILTER_LEAD_GAIN_MAX    32      // 超前补偿最大高频增益(限制噪声放大)
+#define FILTER_LEAD_MIN_SAMPLES 2       // 超前补偿低通时间常数tau/G的下限(采样周期数)
+
+/* 滤波级类型 */
+#define FILTER_TYPE_BOXCAR      1       // 滑动平均(运行和)
+#define FILTER_TYPE_MEDIAN      2       // 滑动中值
+#define FILTER_TYPE_IIR         3       // 一阶IIR低通 y += alpha * (x - y)
+#define FILTER_TYPE_FIR         4       // FIR, Q15系数
+#define FILTER_TYPE_LEAD        5       // 一阶滞后逆(超前补偿) (tau*s + 1) / (tau/G*s + 1)
+
+/* 滑动平均 */
+typedef struct
+{
+    int32_t buffer[FILTER_BOXCAR_MAX];  // 窗口内采样
+    int32_t sum;                        // 窗口运行和
+    uint8_t length;                     // 窗口长度
+    uint8_t index;                      // 下一个写入位置
+    uint8_t count;                      // 已填充采样数
+} Filter_BoxcarTypeDef;
+
+/* 滑动中值 */
+typedef struct
+{
+    int32_t buffer[FILTER_MEDIAN_MAX];  // 按到达顺序的窗口
+    int32_t sorted[FILTER_MEDIAN_MAX];  // 升序排列的窗口
+    uint8_t length;                     // 窗口长度
+    uint8_t index;                      // 下一个写入位置
+    uint8_t count;                      // 已填充采样数
+} Filter_MedianTypeDef;
+
+/* 一阶IIR */
+typedef struct
+{
+    int32_t state;                      // 输出状态, 扩展8位小数
+    int16_t alpha;                      // 系数, Q15
+    uint8_t primed;                     // 已用第一个采样初始化
+} Filter_IIRTypeDef;
+
+/* FIR */
+typedef struct
+{
+    int32_t history[FILTER_FIR_MAX_TAPS];   // 输入历史(环形)
+    int16_t coeffs[FILTER_FIR_MAX_TAPS];    // 系数, Q15
+    uint8_t taps;                           // 阶数
+    uint8_t index;                          // 最新采样位置
+} Filter_FIRTypeDef;
+
+/* 超前补偿 */
+typedef struct
+{
+    int32_t state;                      // 低通状态, 扩展8位小数
+    int16_t alpha;                      // 低通系数 T / (tau/G), Q15
+    uint16_t gain;                      // 高频增益 G, Q8
+    uint8_t primed;                     // 已用第一个采样初始化
+} Filter_LeadTypeDef;
+
+/* 滤波级 */
+typedef struct
+{
+    uint8_t type;                       // FILTER_TYPE_xxx
+    union
+    {
+        Filter_BoxcarTypeDef boxcar;
+        Filter_MedianTypeDef median;
+        Filter_IIRTypeDef iir;
+        Filter_FIRTypeDef fir;
+        Filter_LeadTypeDef lead;
+    } u;
+    uint32_t cycles_acc;                // 当前统计窗口累计CPU周期数
+    uint16_t samples;                   // 当前统计窗口采样点数
+    uint32_t cycles_per_sample;         // 最近测得的每采样CPU周期数
+    uint32_t cycles_max;                // 每采样CPU周期数峰值(按统计窗口平均)
+} Filter_StageTypeDef;
+
+/* 滤波链: 每个通道一条, 采样依次通过各级 */
+typedef struct
+{
+    Filter_StageTypeDef stage[FILTER_CHAIN_MAX_STAGES];
+    uint8_t count;                      // 已添加级数
+} Filter_ChainTypeDef;
+
+/* 函数声明 */
+uint8_t Filter_BoxcarInit(Filter_StageTypeDef *stage, uint8_t length);   // 初始化滑动平均级
+uint8_t Filter_MedianInit(Filter_StageTypeDef *stage, uint8_t length);   // 初始化滑动中值级
+uint8_t Filter_IIRInit(Filter_StageTypeDef *stage, int16_t alpha_q15);   // 初始化一阶IIR级
+uint8_t Filter_FIRInit(Filter_StageTypeDef *stage, const int16_t *coeffs, uint8_t taps); // 初始化FIR级
+uint8_t Filter_LeadInit(Filter_StageTypeDef *stage, uint32_t tau_ms, uint32_t rate_mhz, uint8_t gain); // 初始化超前补偿级
+int32_t Filter_Process(Filter_StageTypeDef *stage, int32_t x);           // 单级处理一个采样
+void Filter_ChainInit(Filter_ChainTypeDef *chain);                        // 初始化空滤波链
+Filter_StageTypeDef *Filter_ChainAddStage(Filter_ChainTypeDef *chain);   // 追加一级, 返回待初始化的级
+int32_t Filter_ChainProcess(Filter_ChainTypeDef *chain, int32_t x);      // 滤波链处理一个采样并统计各级周期数
+int16_t Filter_SinQ15(uint16_t phase);                                    // 定点正弦, 65536为一周期
+int32_t Filter_RatioToCentiDb(uint32_t num, uint32_t den);               // 幅度比换算为分贝(0.01dB)
+
+#endif /* __FILTER_H */
@@ -0,0 +1,266 @@
+/*
+ * 文件名: fusion.c
+ * 描述: 多探头卡尔曼融合模块
+ * 功能: 对装在同一物体上的冗余探头做标量卡尔曼融合, 以全采样率逐帧更新,
+ *       各探头噪声方差由新息在线估计, 噪声大或偏离的探头权重自动降低, 故障探头直接剔除
+ */
+
+#include "stm32f10x.h"
+#include "fusion.h"
+#include "systick.h"
+
+/**
+ * @brief  整数平方根
+ * @param  x: 输入
+ * @retval floor(sqrt(x))
+ */
+static uint32_t Fusion_Sqrt(uint32_t x)
+{
+    uint32_t result = 0;
+    uint32_t bit = 1u << 30;
+    
+    while (bit > x)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (x >= result + bit)
+        {
+            x -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    
+    return result;
+}
+
+/**
+ * @brief  按各探头方差重算权重和融合测量方差
+ * @note   逆方差加权: w_i = (1/R_i) / sum(1/R_j), R = 1 / sum(1/R_j); 每块调用一次
+ * @param  fusion: 融合器
+ * @retval 无
+ */
+static void Fusion_UpdateWeights(Fusion_TypeDef *fusion)
+{
+    uint32_t inverse[FUSION_MAX_PROBES];
+    uint32_t sum = 0;
+    uint8_t i;
+    
+    for (i = 0; i < fusion->count; i++)
+    {
+        inverse[i] = (fusion->valid & (1u << i)) ? (1u << 30) / fusion->r[i] : 0;
+        sum += inverse[i];
+    }
+    
+    if (sum == 0)
+        return;
+    
+    for (i = 0; i < fusion->count; i++)
+        fusion->weight[i] = (uint32_t)(((uint64_t)inverse[i] << 16) / sum);
+    fusion->r_fused = ((1u << 30) / sum) << 8;
+}
+
+/**
+ * @brief  初始化融合器
+ * @param  fusion: 融合器
+ * @param  channels: 各探头帧内通道序号
+ * @param  count: 探头数, 1 ~ FUSION_MAX_PROBES
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Fusion_Init(Fusion_TypeDef *fusion, const uint8_t *channels, uint8_t count)
+{
+    uint8_t i;
+    
+    if (channels == 0 || count == 0 || count > FUSION_MAX_PROBES)
+        return 1;
+    
+    fusion->count = count;
+    fusion->valid = (uint8_t)((1u << count) - 1);
+    fusion->primed = 0;
+    for (i = 0; i < count; i++)
+    {
+        fusion->channel[i] = channels[i];
+        fusion->r[i] = FUSION_R_INIT;
+        fusion->innov_acc[i] = 0;
+    }
+    fusion->x = 0;
+    fusion->p = 0;
+    fusion->cycles_per_frame = 0;
+    Fusion_UpdateWeights(fusion);
+    
+    return 0;
+}
+
+/**
+ * @brief  单探头直通
+ * @note   只有一个探头时无可融合, 卡尔曼平滑只会给主温度路径增加群延迟, 故原样输出;
+ *         测量方差由相邻帧之差估计(差值方差为2R), 估计方差即单帧测量方差, 供Fusion_GetEstimate
+ * @param  fusion: 融合器
+ * @param  data: 12位右对齐采样数据(数据块起始地址)
+ * @param  length: 帧数
+ * @param  stride: 每帧通道数
+ * @param  output: 每帧输出, 16位(FUSION_OUT_FRAC_BITS位小数)
+ * @retval 无
+ */
+static void Fusion_PassThrough(Fusion_TypeDef *fusion, const uint16_t *data, uint16_t length, uint8_t stride,
+                               uint16_t *output)
+{
+    uint32_t start = GetCycleCount();
+    int32_t z, e;
+    uint16_t n;
+    
+    for (n = 0; n < length; n++)
+    {
+        z = (int32_t)data[n * stride + fusion->channel[0]] << 16;
+        if (!fusion->primed)
+        {
+            fusion->x = z;
+            fusion->primed = 1;
+        }
+    
+        e = (z - fusion->x) >> 12;
+        if (e > FUSION_INNOV_CLAMP)
+            e = FUSION_INNOV_CLAMP;
+        if (e < -FUSION_INNOV_CLAMP)
+            e = -FUSION_INNOV_CLAMP;
+        fusion->innov_acc[0] += (uint32_t)(e * e);
+        fusion->x = z;
+        output[n] = (uint16_t)(z >> (16 - FUSION_OUT_FRAC_BITS));
+    }
+    
+    if (length > 0)
+    {
+        fusion->r[0] += ((int32_t)(fusion->innov_acc[0] / length / 2) - (int32_t)fusion->r[0]) >> FUSION_R_SHIFT;
+        if (fusion->r[0] < FUSION_R_MIN)
+            fusion->r[0] = FUSION_R_MIN;
+        if (fusion->r[0] > FUSION_R_MAX)
+            fusion->r[0] = FUSION_R_MAX;
+        fusion->innov_acc[0] = 0;
+        Fusion_UpdateWeights(fusion);
+        fusion->p = fusion->r_fused;
+        fusion->cycles_per_frame = (GetCycleCount() - start) / length;
+    }
+}
+
+/**
+ * @brief  融合一块采样
+ * @note   在ADC数据块回调(DMA中断)中调用, 每帧: 加权合成测量 -> 预测 P += Q ->
+ *         更新 K = P / (P + R), x += K (z - x), P -= K P, 一次32位除法;
+ *         块末由各探头新息方差更新R_i和权重; 无有效探头时保持估计不变; 单探头时直通
+ * @param  fusion: 融合器
+ * @param  data: 12位右对齐采样数据(数据块起始地址)
+ * @param  length: 帧数
+ * @param  stride: 每帧通道数
+ * @param  valid: 本块可用探头位掩码(对应Fusion_Init的探头顺序), 故障探头清零
+ * @param  output: 每帧融合估计输出, 16位(FUSION_OUT_FRAC_BITS位小数), 容量不小于length
+ * @retval 无
+ */
+void Fusion_PushBlock(Fusion_TypeDef *fusion, const uint16_t *data, uint16_t length, uint8_t stride,
+                      uint8_t valid, uint16_t *output)
+{
+    uint32_t start = GetCycleCount();
+    const uint16_t *frame;
+    int32_t z, e;
+    uint32_t p, s, k;
+    uint16_t n;
+    uint8_t i;
+    
+    valid &= (uint8_t)((1u << fusion->count) - 1);
+    if (valid != fusion->valid)
+    {
+        fusion->valid = valid;
+        Fusion_UpdateWeights(fusion);
+    }
+    
+    if (fusion->count == 1 && valid != 0)
+    {
+        Fusion_PassThrough(fusion, data, length, stride, output);
+        return;
+    }
+    
+    for (n = 0; n < length; n++)
+    {
+        frame = data + n * stride;
+    
+        if (valid == 0)
+        {
+            output[n] = (uint16_t)((fusion->x + (1 << (15 - FUSION_OUT_FRAC_BITS))) >> (16 - FUSION_OUT_FRAC_BITS));
+            continue;
+        }
+    
+        /* 加权合成测量, Q16计数 */
+        z = 0;
+        for (i = 0; i < fusion->count; i++)
+            z += (int32_t)(fusion->weight[i] * frame[fusion->channel[i]]);
+    
+        if (!fusion->primed)
+        {
+            fusion->x = z;
+            fusion->p = fusion->r_fused;
+            fusion->primed = 1;
+        }
+    
+        /* 各探头新息(相对先验估计), Q4计数, 累加平方用于估计方差 */
+        for (i = 0; i < fusion->count; i++)
+        {
+            e = ((int32_t)frame[fusion->channel[i]] << 4) - (fusion->x >> 12);
+            if (e > FUSION_INNOV_CLAMP)
+                e = FUSION_INNOV_CLAMP;
+            if (e < -FUSION_INNOV_CLAMP)
+                e = -FUSION_INNOV_CLAMP;
+            fusion->innov_acc[i] += (uint32_t)(e * e);
+        }
+    
+        /* 预测和更新; 除法前把P和P+R同时右移到P不超过16位 */
+        fusion->p += FUSION_PROCESS_NOISE;
+        p = fusion->p;
+        s = fusion->p + fusion->r_fused;
+        while (p > 0xFFFF)
+        {
+            p >>= 1;
+            s >>= 1;
+        }
+        k = (p << 16) / s;
+        fusion->x += (int32_t)(((int64_t)(z - fusion->x) * k) >> 16);
+        fusion->p -= (uint32_t)(((uint64_t)fusion->p * k) >> 16);
+    
+        output[n] = (uint16_t)((fusion->x + (1 << (15 - FUSION_OUT_FRAC_BITS))) >> (16 - FUSION_OUT_FRAC_BITS));
+    }
+    
+    /* 块末更新各探头方差估计和权重 */
+    if (valid != 0 && length > 0)
+    {
+        for (i = 0; i < fusion->count; i++)
+        {
+            if (valid & (1u << i))
+            {
+                fusion->r[i] += ((int32_t)(fusion->innov_acc[i] / length) - (int32_t)fusion->r[i]) >> FUSION_R_SHIFT;
+                if (fusion->r[i] < FUSION_R_MIN)
+                    fusion->r[i] = FUSION_R_MIN;
+                if (fusion->r[i] > FUSION_R_MAX)
+                    fusion->r[i] = FUSION_R_MAX;
+            }
+            fusion->innov_acc[i] = 0;
+        }
+        Fusion_UpdateWeights(fusion);
+        fusion->cycles_per_frame = (GetCycleCount() - start) / length;
+    }
+}
+
+/**
+ * @brief  获取融合估计值及标准差
+ * @param  fusion: 融合器
+ * @param  sigma: 估计标准差输出(Q4计数), 可为0
+ * @retval 估计值, 16位(FUSION_OUT_FRAC_BITS位小数)
+ */
+uint16_t Fusion_GetEstimate(const Fusion_TypeDef *fusion, uint16_t *sigma)
+{
+    if (sigma)
+        *sigma = (uint16_t)(Fusion_Sqrt(fusion->p) >> (8 - FUSION_OUT_FRAC_BITS));
+    
+    return (uint16_t)((fusion->x + (1 << (15 - FUSION_OUT_FRAC_BITS))) >> (16 - FUSION_OUT_FRAC_BITS));
+}
@@ -0,0 +1,44 @@
+/*
+ * 文件名: fusion.h
+ * 描述: 多探头卡尔曼融合模块头文件
+ * 功能: 声明冗余探头标量卡尔曼融合相关类型和函数
+ */
+
+#ifndef __FUSION_H
+#define __FUSION_H
+
+#include "stm32f10x.h"
+
+/* 融合参数 (ADC计数空间, 参与融合的探头须为同型号、同换算系数) */
+#define FUSION_MAX_PROBES       4           // 最多融合探头数
+#define FUSION_OUT_FRAC_BITS    4           // 输出小数位数, 输出为16位(12位整数 + 4位小数)
+#define FUSION_PROCESS_NOISE    7           // 每帧过程噪声方差, Q16计数^2 (约1e-4, 稳态带宽约10Hz)
+#define FUSION_R_INIT           (4 << 8)    // 初始测量噪声方差, Q8计数^2 (标准差2LSB)
+#define FUSION_R_MIN            16          // 测量噪声方差下限, Q8计数^2
+#define FUSION_R_MAX            (16383u << 8)   // 测量噪声方差上限, Q8计数^2
+#define FUSION_R_SHIFT          3           // 方差估计每块更新的平滑系数 1/2^n
+#define FUSION_INNOV_CLAMP      4095        // 新息限幅(Q4计数), 防止平方和溢出
+
+/* 融合器 */
+typedef struct
+{
+    uint8_t count;                          // 探头数
+    uint8_t channel[FUSION_MAX_PROBES];     // 各探头帧内通道序号
+    uint8_t valid;                          // 当前参与融合的探头位掩码
+    uint8_t primed;                         // 已用第一帧初始化
+    uint32_t r[FUSION_MAX_PROBES];          // 各探头测量噪声方差估计, Q8计数^2
+    uint32_t weight[FUSION_MAX_PROBES];     // 各探头权重(与方差成反比), Q16, 和为65536
+    uint32_t r_fused;                       // 加权融合后的测量方差, Q16计数^2
+    uint32_t innov_acc[FUSION_MAX_PROBES];  // 当前块新息平方和, Q8计数^2 (块长不超过255帧时不溢出)
+    int32_t x;                              // 状态估计, Q16计数
+    uint32_t p;                             // 估计方差, Q16计数^2
+    uint32_t cycles_per_frame;              // 最近测得的每帧CPU周期数
+} Fusion_TypeDef;
+
+/* 函数声明 */
+uint8_t Fusion_Init(Fusion_TypeDef *fusion, const uint8_t *channels, uint8_t count); // 初始化融合器
+void Fusion_PushBlock(Fusion_TypeDef *fusion, const uint16_t *data, uint16_t length, uint8_t stride,
+                      uint8_t valid, uint16_t *output);   // 融合一块采样, 输出每帧估计
+uint16_t Fusion_GetEstimate(const Fusion_TypeDef *fusion, uint16_t *sigma); // 获取估计值及标准差(Q4计数)
+
+#endif /* __FUSION_H */
@@ -0,0 +1,202 @@
+/*
+ * 文件名: health.c
+ * 描述: 传感器健康监测模块
+ * 功能: 在采样流上逐点统计, 检测贴轨、卡死、噪声过大和变化率异常等传感器故障,
+ *       每个采样O(1)开销, 每窗口结束时判定一次
+ */
+
+#include "stm32f10x.h"
+#include "health.h"
+#include "systick.h"
+#include <stdio.h>
+
+/**
+ * @brief  初始化监测器
+ * @note   限值取默认值, 可在初始化后按通道修改
+ * @param  mon: 监测器
+ * @retval 无
+ */
+void Health_Init(Health_TypeDef *mon)
+{
+    mon->rail_low = HEALTH_RAIL_LOW;
+    mon->rail_high = HEALTH_RAIL_HIGH;
+    mon->noise_limit = HEALTH_NOISE_LIMIT;
+    mon->slew_limit = HEALTH_SLEW_LIMIT;
+    
+    mon->sum = 0;
+    mon->sum_sq = 0;
+    mon->min = 0xFFFF;
+    mon->max = 0;
+    mon->rail_low_count = 0;
+    mon->rail_high_count = 0;
+    mon->count = 0;
+    
+    mon->last_mean = 0;
+    mon->has_mean = 0;
+    mon->stuck_windows = 0;
+    mon->clean_windows = 0;
+    mon->faults = HEALTH_FAULT_NONE;
+    mon->cycles_per_sample = 0;
+}
+
+/**
+ * @brief  窗口结束判定
+ * @note   方差用 N*sum_sq - sum^2 与 (限值*N)^2 比较, 无需除法
+ * @param  mon: 监测器
+ * @retval 无
+ */
+static void Health_EvaluateWindow(Health_TypeDef *mon)
+{
+    uint8_t window_faults = HEALTH_FAULT_NONE;
+    uint64_t var_n2;
+    uint64_t limit_n2;
+    uint16_t mean;
+    
+    /* 贴轨: 窗口内过半采样贴轨 */
+    if (mon->rail_low_count >= HEALTH_WINDOW / 2)
+        window_faults |= HEALTH_FAULT_RAIL_LOW;
+    if (mon->rail_high_count >= HEALTH_WINDOW / 2)
+        window_faults |= HEALTH_FAULT_RAIL_HIGH;
+    
+    /* 卡死: 连续多个窗口完全无变化(贴轨时已单独报告) */
+    if (mon->max == mon->min && window_faults == HEALTH_FAULT_NONE)
+    {
+        if (mon->stuck_windows < HEALTH_STUCK_WINDOWS)
+            mon->stuck_windows++;
+        if (mon->stuck_windows >= HEALTH_STUCK_WINDOWS)
+            window_faults |= HEALTH_FAULT_STUCK;
+    }
+    else
+    {
+        mon->stuck_windows = 0;
+    }
+    
+    /* 噪声: N^2 * 方差 > N^2 * 限值^2 */
+    var_n2 = (mon->sum_sq << HEALTH_WINDOW_SHIFT) - (uint64_t)mon->sum * mon->sum;
+    limit_n2 = ((uint64_t)mon->noise_limit * mon->noise_limit) << (2 * HEALTH_WINDOW_SHIFT);
+    if (var_n2 > limit_n2)
+        window_faults |= HEALTH_FAULT_NOISE;
+    
+    /* 变化率: 相邻窗口均值跳变超过物理可能 */
+    mean = (uint16_t)((mon->sum + HEALTH_WINDOW / 2) >> HEALTH_WINDOW_SHIFT);
+    if (mon->has_mean)
+    {
+        if ((mean > mon->last_mean ? mean - mon->last_mean : mon->last_mean - mean) > mon->slew_limit)
+            window_faults |= HEALTH_FAULT_SLEW;
+    }
+    mon->last_mean = mean;
+    mon->has_mean = 1;
+    
+    /* 故障立即置位, 连续HEALTH_CLEAR_WINDOWS个正常窗口后清除 */
+    if (window_faults != HEALTH_FAULT_NONE)
+    {
+        mon->faults |= window_faults;
+        mon->clean_windows = 0;
+    }
+    else if (mon->faults != HEALTH_FAULT_NONE && ++mon->clean_windows >= HEALTH_CLEAR_WINDOWS)
+    {
+        mon->faults = HEALTH_FAULT_NONE;
+        mon->clean_windows = 0;
+    }
+    
+    /* 开始新窗口 */
+    mon->sum = 0;
+    mon->sum_sq = 0;
+    mon->min = 0xFFFF;
+    mon->max = 0;
+    mon->rail_low_count = 0;
+    mon->rail_high_count = 0;
+    mon->count = 0;
+}
+
+/**
+ * @brief  输入一块采样数据
+ * @note   可在ADC数据块回调(DMA中断)中调用, 每采样仅做比较和乘累加
+ * @param  mon: 监测器
+ * @param  data: 12位右对齐采样数据
+ * @param  length: 采样点数
+ * @param  stride: 相邻采样点间隔(多通道交织数据取通道数, 单通道取1)
+ * @retval 无
+ */
+void Health_PushBlock(Health_TypeDef *mon, const uint16_t *data, uint16_t length, uint8_t stride)
+{
+    uint32_t start = GetCycleCount();
+    uint16_t x;
+    uint16_t i;
+    
+    for (i = 0; i < length; i++)
+    {
+        x = data[i * stride];
+    
+        mon->sum += x;
+        mon->sum_sq += (uint32_t)x * x;
+        if (x < mon->min)
+            mon->min = x;
+        if (x > mon->max)
+            mon->max = x;
+        if (x <= mon->rail_low)
+            mon->rail_low_count++;
+        else if (x >= mon->rail_high)
+            mon->rail_high_count++;
+    
+        if (++mon->count >= HEALTH_WINDOW)
+            Health_EvaluateWindow(mon);
+    }
+    
+    if (length > 0)
+        mon->cycles_per_sample = (GetCycleCount() - start) / length;
+}
+
+/**
+ * @brief  单点贴轨检查
+ * @note   供中断中的快速路径(如模拟看门狗)在窗口判定之前排除明显的贴轨读数
+ * @param  mon: 监测器
+ * @param  value: 12位原始值
+ * @retval HEALTH_FAULT_RAIL_LOW / HEALTH_FAULT_RAIL_HIGH / HEALTH_FAULT_NONE
+ */
+uint8_t Health_CheckSample(const Health_TypeDef *mon, uint16_t value)
+{
+    if (value <= mon->rail_low)
+        return HEALTH_FAULT_RAIL_LOW;
+    if (value >= mon->rail_high)
+        return HEALTH_FAULT_RAIL_HIGH;
+    
+    return HEALTH_FAULT_NONE;
+}
+
+/**
+ * @brief  获取故障标志
+ * @param  mon: 监测器
+ * @retval HEALTH_FAULT_xxx 组合, 0为正常
+ */
+uint8_t Health_GetFaults(const Health_TypeDef *mon)
+{
+    return mon->faults;
+}
+
+/**
+ * @brief  故障标志格式化为文本
+ * @param  buffer: 输出缓冲区, 至少40字节
+ * @param  faults: 故障标志
+ * @retval 写入的字符数
+ */
+int Health_FormatFaults(char *buffer, uint8_t faults)
+{
+    int length = 0;
+    
+    if (faults == HEALTH_FAULT_NONE)
+        return sprintf(buffer, "OK");
+    
+    if (faults & HEALTH_FAULT_RAIL_LOW)
+        length += sprintf(buffer + length, "%sRAIL_LOW", length ? "|" : "");
+    if (faults & HEALTH_FAULT_RAIL_HIGH)
+        length += sprintf(buffer + length, "%sRAIL_HIGH", length ? "|" : "");
+    if (faults & HEALTH_FAULT_STUCK)
+        length += sprintf(buffer + length, "%sSTUCK", length ? "|" : "");
+    if (faults & HEALTH_FAULT_NOISE)
+        length += sprintf(buffer + length, "%sNOISE", length ? "|" : "");
+    if (faults & HEALTH_FAULT_SLEW)
+        length += sprintf(buffer + length, "%sSLEW", length ? "|" : "");
+    
+    return length;
+}
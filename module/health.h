@@ -0,0 +1,62 @@
+/*
+ * 文件名: health.h
+ * 描述: 传感器健康监测模块头文件
+ * 功能: 声明传感器故障检测相关类型和函数
+ */
+
+#ifndef __HEALTH_H
+#define __HEALTH_H
+
+#include "stm32f10x.h"
+
+/* 检测参数 (12位原始ADC值) */
+#define HEALTH_WINDOW           256     // 统计窗口采样点数(2的幂)
+#define HEALTH_WINDOW_SHIFT     8       // log2(HEALTH_WINDOW)
+#define HEALTH_RAIL_LOW         4       // 低于等于该值视为贴近地轨
+#define HEALTH_RAIL_HIGH        4091    // 高于等于该值视为贴近电源轨
+#define HEALTH_NOISE_LIMIT      32      // 窗口标准差上限(LSB)
+#define HEALTH_SLEW_LIMIT       64      // 相邻窗口均值最大变化(LSB)
+#define HEALTH_STUCK_WINDOWS    50      // 连续多少个窗口无变化判为卡死
+#define HEALTH_CLEAR_WINDOWS    25      // 连续多少个正常窗口后清除故障
+
+/* 故障标志(可同时存在) */
+#define HEALTH_FAULT_NONE       0x00    // 正常
+#define HEALTH_FAULT_RAIL_LOW   0x01    // 贴地: 断线(下拉)或对地短路
+#define HEALTH_FAULT_RAIL_HIGH  0x02    // 贴电源: 对电源短路
+#define HEALTH_FAULT_STUCK      0x04    // 信号零方差(卡死)
+#define HEALTH_FAULT_NOISE      0x08    // 噪声过大: 悬空或接触不良
+#define HEALTH_FAULT_SLEW       0x10    // 变化率超出物理可能
+
+/* 单通道健康监测器 */
+typedef struct
+{
+    /* 检测限值, 初始化为默认值, 可按通道调整 */
+    uint16_t rail_low;          // 地轨阈值
+    uint16_t rail_high;         // 电源轨阈值
+    uint16_t noise_limit;       // 标准差上限(LSB)
+    uint16_t slew_limit;        // 相邻窗口均值最大变化(LSB)
+    /* 当前窗口统计 */
+    uint32_t sum;               // 采样和
+    uint64_t sum_sq;            // 采样平方和
+    uint16_t min;               // 最小值
+    uint16_t max;               // 最大值
+    uint16_t rail_low_count;    // 贴地轨采样数
+    uint16_t rail_high_count;   // 贴电源轨采样数
+    uint16_t count;             // 已统计采样数
+    /* 窗口间状态 */
+    uint16_t last_mean;         // 上一窗口均值
+    uint8_t has_mean;           // last_mean有效
+    uint8_t stuck_windows;      // 连续无变化窗口数
+    uint8_t clean_windows;      // 连续正常窗口数
+    volatile uint8_t faults;    // 当前故障标志 HEALTH_FAULT_xxx
+    uint32_t cycles_per_sample; // 最近测得的每采样CPU周期数
+} Health_TypeDef;
+
+/* 函数声明 */
+void Health_Init(Health_TypeDef *mon);      // 初始化监测器
+void Health_PushBlock(Health_TypeDef *mon, const uint16_t *data, uint16_t length, uint8_t stride); // 输入一块采样
+uint8_t Health_CheckSample(const Health_TypeDef *mon, uint16_t value);  // 单点贴轨检查
+uint8_t Health_GetFaults(const Health_TypeDef *mon);                    // 获取故障标志
+int Health_FormatFaults(char *buffer, uint8_t faults);                  // 故障标志格式化为文本
+
+#endif /* __HEALTH_H */
@@ -15,8 +15,8 @@ void GPIO_Config(void)
 {
     GPIO_InitTypeDef GPIO_InitStructure;
     
-    /* 使能GPIOA时钟 */
-    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
+    /* 使能GPIOA、GPIOB时钟 */
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA | RCC_APB2Periph_GPIOB, ENABLE);
     
     /* 配置PA0为推挽输出 - 绿色LED */
     GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0;
@@ -24,6 +24,15 @@ void GPIO_Config(void)
     GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
     GPIO_Init(GPIOA, &GPIO_InitStructure);
     
+    /* 配置PB12为推挽输出 - 超温报警输出 */
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_12;
+    GPIO_Init(GPIOB, &GPIO_InitStructure);
+    GPIO_ResetBits(GPIOB, GPIO_Pin_12);
+    
+    /* 配置PB13为推挽输出 - 提前报警输出(滞后补偿) */
+    GPIO_InitStructure.GPIO_Pin = GPIO_Pin_13;
+    GPIO_Init(GPIOB, &GPIO_InitStructure);
+    GPIO_ResetBits(GPIOB, GPIO_Pin_13);
     
     /* 配置PA8为上拉输入 - 按键 */
     GPIO_InitStructure.GPIO_Pin = GPIO_Pin_8;
@@ -61,7 +70,7 @@ void EXTI_Config(void)
     /* 配置中断优先级 - 确保高于SysTick */
     NVIC_InitStructure.NVIC_IRQChannel = EXTI9_5_IRQn; // EXTI8在EXTI9_5_IRQn中
     NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0x0E; // 优先级高于SysTick
-    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0x0E;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
 }
@@ -106,4 +115,8 @@ void uesr_SystemInit(void)
     /* 配置Flash访问时间 */
     FLASH_SetLatency(FLASH_Latency_2);
     FLASH_PrefetchBufferCmd(FLASH_PrefetchBuffer_Enable);
+    
+    /* 中断优先级分组: 4位全部用于抢占优先级(0~15), 无子优先级;
+     * 须在任何NVIC_Init之前设置, 否则各模块配置的抢占优先级不生效 */
+    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
 }
@@ -0,0 +1,82 @@
+/*
+ * 文件名: mains.c
+ * 描述: 工频同步积分模块
+ * 功能: 按工频周期整数倍配置采样率, 使过采样抽取窗口恰好覆盖一个工频周期,
+ *       窗口均值对工频及其各次谐波的响应为零(sinc零点); 并用合成测试向量测量实际抑制量
+ */
+
+#include "stm32f10x.h"
+#include "mains.h"
+#include "oversample.h"
+#include "filter.h"
+
+/**
+ * @brief  计算工频同步采样率
+ * @note   采样由TIM3定时触发, 定时器分频取整后实际采样率可能有万分之一级偏差,
+ *         以ADC_SetSampleRate返回值为准
+ * @param  mains_hz: 工频频率 MAINS_HZ_50 / MAINS_HZ_60
+ * @param  ratio: 每个工频周期的采样点数(过采样倍率)
+ * @retval 采样率(Hz), 参数无效时返回0
+ */
+uint32_t Mains_SyncRate(uint16_t mains_hz, uint16_t ratio)
+{
+    if (mains_hz != MAINS_HZ_50 && mains_hz != MAINS_HZ_60)
+        return 0;
+    
+    return (uint32_t)mains_hz * ratio;
+}
+
+/**
+ * @brief  测量过采样抽取器对正弦干扰的抑制
+ * @note   按实际采样率生成 直流 + 正弦 的12位测试向量送入独立的抽取器,
+ *         抑制量 = 输入峰峰值 / 输出峰峰值(折算到同一位宽);
+ *         输出量化为1LSB时为测量下限, 16位输出约90dB; 耗时约几毫秒, 在主循环中调用
+ * @param  rate_hz: 采样率(Hz)
+ * @param  ratio: 过采样倍率
+ * @param  out_bits: 输出位宽
+ * @param  tone_mhz: 干扰频率(mHz)
+ * @retval 抑制量(0.01dB), 参数无效时返回0
+ */
+int32_t Mains_MeasureRejection(uint32_t rate_hz, uint16_t ratio, uint8_t out_bits, uint32_t tone_mhz)
+{
+    Oversample_TypeDef ovs;
+    uint16_t block[MAINS_TEST_BLOCK];
+    uint32_t phase = 0;
+    uint32_t step;
+    uint16_t value, out_min = 0xFFFF, out_max = 0;
+    uint16_t outputs = 0;
+    uint16_t chunk, i;
+    
+    if (rate_hz == 0 || Oversample_Init(&ovs, ratio, out_bits))
+        return 0;
+    
+    /* 每采样相位增量, 2^32对应一个周期 */
+    step = (uint32_t)(((uint64_t)tone_mhz << 32) / ((uint64_t)rate_hz * 1000));
+    
+    /* 每次至多产生一个输出 */
+    chunk = (ratio < MAINS_TEST_BLOCK) ? ratio : MAINS_TEST_BLOCK;
+    
+    while (outputs < MAINS_TEST_OUTPUTS)
+    {
+        for (i = 0; i < chunk; i++)
+        {
+            block[i] = (uint16_t)(MAINS_TEST_OFFSET +
+                                  ((MAINS_TEST_AMPLITUDE * Filter_SinQ15((uint16_t)(phase >> 16)) + 16384) >> 15));
+            phase += step;
+        }
+        Oversample_PushBlock(&ovs, block, chunk, 1);
+    
+        if (Oversample_GetOutput(&ovs, &value))
+        {
+            if (value < out_min)
+                out_min = value;
+            if (value > out_max)
+                out_max = value;
+            outputs++;
+        }
+    }
+    
+    /* 输出峰峰值不足1LSB按1LSB计 */
+    return Filter_RatioToCentiDb((uint32_t)(2 * MAINS_TEST_AMPLITUDE) << (out_bits - OVERSAMPLE_BITS_MIN),
+                                 (out_max > out_min) ? (uint32_t)(out_max - out_min) : 1);
+}
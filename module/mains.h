@@ -0,0 +1,26 @@
+/*
+ * 文件名: mains.h
+ * 描述: 工频同步积分模块头文件
+ * 功能: 声明工频同步采样率计算和工频抑制测量函数
+ */
+
+#ifndef __MAINS_H
+#define __MAINS_H
+
+#include "stm32f10x.h"
+
+/* 工频频率 */
+#define MAINS_HZ_50             50          // 50Hz, 积分周期20ms
+#define MAINS_HZ_60             60          // 60Hz, 积分周期16.67ms
+
+/* 抑制测量参数: 合成测试向量 = 中点直流 + 工频正弦 */
+#define MAINS_TEST_OFFSET       2048        // 直流分量(LSB)
+#define MAINS_TEST_AMPLITUDE    1000        // 工频正弦幅度(LSB)
+#define MAINS_TEST_OUTPUTS      64          // 统计的抽取输出个数
+#define MAINS_TEST_BLOCK        128         // 每次生成的采样点数
+
+/* 函数声明 */
+uint32_t Mains_SyncRate(uint16_t mains_hz, uint16_t ratio);    // 工频同步采样率: 每个工频周期恰好ratio个采样
+int32_t Mains_MeasureRejection(uint32_t rate_hz, uint16_t ratio, uint8_t out_bits, uint32_t tone_mhz); // 测量抽取器对正弦干扰的抑制(0.01dB)
+
+#endif /* __MAINS_H */
@@ -0,0 +1,150 @@
+/*
+ * 文件名: oversample.c
+ * 描述: 过采样抽取模块
+ * 功能: 对高速ADC采样流做累加抽取, 每4倍过采样提高1位有效分辨率
+ */
+
+#include "stm32f10x.h"
+#include "oversample.h"
+#include "systick.h"
+
+/**
+ * @brief  初始化过采样抽取器
+ * @note   增加e位分辨率至少需要4^e倍过采样, 输出 = 累加和 >> (log2(ratio) - e)
+ * @param  ovs: 抽取器
+ * @param  ratio: 过采样倍率, 4~256且为2的幂
+ * @param  out_bits: 输出位宽, 12~16
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Oversample_Init(Oversample_TypeDef *ovs, uint16_t ratio, uint8_t out_bits)
+{
+    uint8_t log2_ratio = 0;
+    uint8_t extra_bits;
+    
+    /* 检查倍率范围并且为2的幂 */
+    if (ratio < OVERSAMPLE_RATIO_MIN || ratio > OVERSAMPLE_RATIO_MAX || (ratio & (ratio - 1)) != 0)
+        return 1;
+    
+    /* 检查输出位宽 */
+    if (out_bits < OVERSAMPLE_BITS_MIN || out_bits > OVERSAMPLE_BITS_MAX)
+        return 1;
+    
+    while ((1u << log2_ratio) < ratio)
+        log2_ratio++;
+    
+    /* 倍率不足以支撑所需位宽 */
+    extra_bits = out_bits - OVERSAMPLE_BITS_MIN;
+    if (2 * extra_bits > log2_ratio)
+        return 1;
+    
+    ovs->accumulator = 0;
+    ovs->count = 0;
+    ovs->ratio = ratio;
+    ovs->shift = log2_ratio - extra_bits;
+    ovs->out_bits = out_bits;
+    ovs->output = 0;
+    ovs->ready = 0;
+    ovs->cycles_acc = 0;
+    ovs->cycles_per_output = 0;
+    ovs->cycles_max = 0;
+    
+    return 0;
+}
+
+/**
+ * @brief  输入一块采样数据
+ * @note   可在ADC数据块回调(DMA中断)中调用, 同时统计每个输出样本的CPU周期数
+ * @param  ovs: 抽取器
+ * @param  data: 12位右对齐采样数据
+ * @param  length: 采样点数
+ * @param  stride: 相邻采样点间隔(多通道交织数据取通道数, 单通道取1)
+ * @retval 无
+ */
+void Oversample_PushBlock(Oversample_TypeDef *ovs, const uint16_t *data, uint16_t length, uint8_t stride)
+{
+    uint32_t start = GetCycleCount();
+    uint32_t acc = ovs->accumulator;
+    uint16_t count = ovs->count;
+    uint16_t outputs = 0;
+    uint16_t i;
+    
+    for (i = 0; i < length; i++)
+    {
+        acc += data[i * stride];
+    
+        /* 窗口满, 抽取输出一个样本 */
+        if (++count >= ovs->ratio)
+        {
+            ovs->output = (uint16_t)(acc >> ovs->shift);
+            ovs->ready = 1;
+            acc = 0;
+            count = 0;
+            outputs++;
+        }
+    }
+    
+    ovs->accumulator = acc;
+    ovs->count = count;
+    
+    /* 将本次耗时分摊到产生的输出样本上 */
+    ovs->cycles_acc += GetCycleCount() - start;
+    if (outputs > 0)
+    {
+        ovs->cycles_per_output = ovs->cycles_acc / outputs;
+        if (ovs->cycles_per_output > ovs->cycles_max)
+            ovs->cycles_max = ovs->cycles_per_output;
+        ovs->cycles_acc = 0;
+    }
+}
+
+/**
+ * @brief  读取新的抽取输出
+ * @param  ovs: 抽取器
+ * @param  value: 输出值
+ * @retval 1 - 有新输出, 0 - 无新输出
+ */
+uint8_t Oversample_GetOutput(Oversample_TypeDef *ovs, uint16_t *value)
+{
+    if (!ovs->ready)
+        return 0;
+    
+    *value = ovs->output;
+    ovs->ready = 0;
+    
+    return 1;
+}
+
+/**
+ * @brief  设置输入位宽
+ * @note   默认输入为12位ADC原始值; 输入已带小数位(如多探头融合输出)时,
+ *         抽取移位相应增大, 输出满量程仍为 4095 << (out_bits - 12)
+ * @param  ovs: 抽取器, 须已初始化
+ * @param  in_bits: 输入位宽, 12 ~ out_bits
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Oversample_SetInputBits(Oversample_TypeDef *ovs, uint8_t in_bits)
+{
+    uint8_t log2_ratio = 0;
+    
+    if (in_bits < OVERSAMPLE_BITS_MIN || in_bits > ovs->out_bits)
+        return 1;
+    
+    while ((1u << log2_ratio) < ovs->ratio)
+        log2_ratio++;
+    
+    ovs->shift = log2_ratio - (ovs->out_bits - in_bits);
+    
+    return 0;
+}
+
+/**
+ * @brief  丢弃未满的抽取窗口
+ * @note   输入出现间断(如ADC后台校准缺帧)时调用, 下一个输出仅由间断后的连续采样构成
+ * @param  ovs: 抽取器
+ * @retval 无
+ */
+void Oversample_Reset(Oversample_TypeDef *ovs)
+{
+    ovs->accumulator = 0;
+    ovs->count = 0;
+}
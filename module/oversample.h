@@ -0,0 +1,40 @@
+/*
+ * 文件名: oversample.h
+ * 描述: 过采样抽取模块头文件
+ * 功能: 声明过采样抽取相关类型和函数
+ */
+
+#ifndef __OVERSAMPLE_H
+#define __OVERSAMPLE_H
+
+#include "stm32f10x.h"
+
+/* 过采样参数范围 */
+#define OVERSAMPLE_RATIO_MIN    4       // 最小过采样倍率
+#define OVERSAMPLE_RATIO_MAX    256     // 最大过采样倍率
+#define OVERSAMPLE_BITS_MIN     12      // 最小输出位宽(ADC原始位宽)
+#define OVERSAMPLE_BITS_MAX     16      // 最大输出位宽
+
+/* 过采样抽取器 */
+typedef struct
+{
+    uint32_t accumulator;       // 当前抽取窗口累加和
+    uint16_t count;             // 当前窗口已累加采样数
+    uint16_t ratio;             // 过采样倍率(2的幂)
+    uint8_t shift;              // 抽取右移位数
+    uint8_t out_bits;           // 输出位宽
+    volatile uint16_t output;   // 最新输出值, 满量程为 4095 << (out_bits - 12)
+    volatile uint8_t ready;     // 新输出标志
+    uint32_t cycles_acc;        // 尚未分摊的CPU周期数
+    uint32_t cycles_per_output; // 最近测得的每个输出样本CPU周期数
+    uint32_t cycles_max;        // 每个输出样本CPU周期数峰值
+} Oversample_TypeDef;
+
+/* 函数声明 */
+uint8_t Oversample_Init(Oversample_TypeDef *ovs, uint16_t ratio, uint8_t out_bits); // 初始化抽取器
+void Oversample_PushBlock(Oversample_TypeDef *ovs, const uint16_t *data, uint16_t length, uint8_t stride); // 输入一块采样
+uint8_t Oversample_GetOutput(Oversample_TypeDef *ovs, uint16_t *value);              // 读取新输出
+uint8_t Oversample_SetInputBits(Oversample_TypeDef *ovs, uint8_t in_bits);          // 设置输入位宽(默认12位)
+void Oversample_Reset(Oversample_TypeDef *ovs);                                      // 丢弃未满的抽取窗口
+
+#endif /* __OVERSAMPLE_H */
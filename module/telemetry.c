@@ -0,0 +1,296 @@
+/*
+ * 文件名: telemetry.c
+ * 描述: 遥测帧模块
+ * 功能: 将测量值打包为带序号、时间戳和通道号的二进制帧, 由片上CRC单元计算CRC32,
+ *       COBS编码后以0x00分隔写入串口发送队列; 连续采样可批量差分打包; 文本模式保留用于调试
+ */
+
+#include "stm32f10x.h"
+#include "telemetry.h"
+#include "usart.h"
+
+static uint8_t telemetry_mode = TELEMETRY_MODE_ASCII;   // 输出模式
+static uint16_t telemetry_seq = 0;                      // 下一帧序号
+
+/**
+ * @brief  COBS编码
+ * @note   输出不含0x00, 每段以距下一个0的字节数开头, 段长不超过254
+ * @param  in: 原始数据
+ * @param  length: 原始数据长度
+ * @param  out: 输出缓冲区, 容量至少 length + length / 254 + 1
+ * @retval 编码后长度(不含结尾0x00)
+ */
+static uint16_t Telemetry_CobsEncode(const uint8_t *in, uint16_t length, uint8_t *out)
+{
+    uint16_t code_index = 0;    // 当前段长度字节的位置
+    uint16_t out_index = 1;
+    uint8_t code = 1;
+    uint16_t i;
+    
+    for (i = 0; i < length; i++)
+    {
+        if (in[i] == 0)
+        {
+            out[code_index] = code;
+            code_index = out_index++;
+            code = 1;
+            continue;
+        }
+    
+        out[out_index++] = in[i];
+        if (++code == 0xFF)
+        {
+            /* 满254个非零字节, 开始新段 */
+            out[code_index] = code;
+            code_index = out_index++;
+            code = 1;
+        }
+    }
+    out[code_index] = code;
+    
+    return out_index;
+}
+
+/**
+ * @brief  用片上CRC单元计算CRC32
+ * @note   CRC单元按32位字输入, 长度不足4字节整数倍的部分由调用者补0
+ * @param  words: 数据, 32位对齐
+ * @param  count: 字数
+ * @retval CRC32
+ */
+static uint32_t Telemetry_Crc32(uint32_t *words, uint16_t count)
+{
+    CRC_ResetDR();
+    
+    return CRC_CalcBlockCRC(words, count);
+}
+
+/**
+ * @brief  按小端写入32位值
+ * @param  out: 输出位置
+ * @param  value: 数值
+ * @retval 无
+ */
+static void Telemetry_Put32(uint8_t *out, uint32_t value)
+{
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    out[2] = (uint8_t)(value >> 16);
+    out[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief  初始化遥测输出
+ * @param  mode: 输出模式 TELEMETRY_MODE_xxx
+ * @retval 无
+ */
+void Telemetry_Init(uint8_t mode)
+{
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_CRC, ENABLE);
+    telemetry_seq = 0;
+    Telemetry_SetMode(mode);
+}
+
+/**
+ * @brief  设置输出模式
+ * @param  mode: TELEMETRY_MODE_ASCII或TELEMETRY_MODE_BINARY
+ * @retval 0 - 成功, 1 - 参数无效
+ */
+uint8_t Telemetry_SetMode(uint8_t mode)
+{
+    if (mode != TELEMETRY_MODE_ASCII && mode != TELEMETRY_MODE_BINARY)
+        return 1;
+    
+    telemetry_mode = mode;
+    
+    return 0;
+}
+
+/**
+ * @brief  获取输出模式
+ * @param  无
+ * @retval 输出模式 TELEMETRY_MODE_xxx
+ */
+uint8_t Telemetry_GetMode(void)
+{
+    return telemetry_mode;
+}
+
+/**
+ * @brief  发送一帧二进制遥测
+ * @note   整帧(含前后0x00)一次写入发送队列, 队列空间不足时整帧丢弃, 序号照常递增,
+ *         接收端由序号间断得知丢帧. CRC单元为共享资源, 仅在主循环中调用
+ * @param  type: 帧类型 TELEMETRY_TYPE_xxx
+ * @param  channel: 通道号
+ * @param  timestamp: 采样时刻(us, GetSysTime_us时基)
+ * @param  payload: 负载
+ * @param  length: 负载字节数, 0 ~ TELEMETRY_PAYLOAD_MAX
+ * @retval 0 - 已写入发送队列, 1 - 参数无效或发送队列已满
+ */
+uint8_t Telemetry_Send(uint8_t type, uint8_t channel, uint32_t timestamp, const void *payload, uint8_t length)
+{
+    uint32_t frame[(TELEMETRY_FRAME_MAX + 3) / 4];  // 32位对齐, 供CRC单元按字读取
+    uint8_t *bytes = (uint8_t *)frame;
+    const uint8_t *data = (const uint8_t *)payload;
+    uint8_t encoded[TELEMETRY_ENCODED_MAX];
+    uint16_t size = TELEMETRY_HEADER_SIZE + length;
+    uint16_t padded = (size + 3) & ~3u;
+    uint32_t crc;
+    uint16_t i;
+    
+    if (length > TELEMETRY_PAYLOAD_MAX)
+        return 1;
+    
+    /* 帧头, 小端 */
+    bytes[0] = (uint8_t)telemetry_seq;
+    bytes[1] = (uint8_t)(telemetry_seq >> 8);
+    Telemetry_Put32(bytes + 2, timestamp);
+    bytes[6] = channel;
+    bytes[7] = type;
+    telemetry_seq++;
+    
+    for (i = 0; i < length; i++)
+    {
+        bytes[TELEMETRY_HEADER_SIZE + i] = data[i];
+    }
+    
+    /* 补0到整字计算CRC, 之后CRC紧接负载存放, 覆盖补位 */
+    for (i = size; i < padded; i++)
+    {
+        bytes[i] = 0;
+    }
+    crc = Telemetry_Crc32(frame, padded / 4);
+    Telemetry_Put32(bytes + size, crc);
+    
+    encoded[0] = 0x00;
+    size = 1 + Telemetry_CobsEncode(bytes, size + 4, encoded + 1);
+    encoded[size++] = 0x00;
+    
+    return USART_Write(encoded, size);
+}
+
+/**
+ * @brief  发送测量值帧
+ * @param  channel: 通道号
+ * @param  timestamp: 采样时刻(us)
+ * @param  value: 测量值(0.01单位)
+ * @param  flags: 标志位 TELEMETRY_FLAG_xxx
+ * @retval 0 - 已写入发送队列, 1 - 发送队列已满
+ */
+uint8_t Telemetry_SendValue(uint8_t channel, uint32_t timestamp, int32_t value, uint8_t flags)
+{
+    uint8_t payload[5];
+    
+    Telemetry_Put32(payload, (uint32_t)value);
+    payload[4] = flags;
+    
+    return Telemetry_Send(TELEMETRY_TYPE_VALUE, channel, timestamp, payload, sizeof(payload));
+}
+
+/**
+ * @brief  发送状态帧
+ * @param  timestamp: 时刻(us)
+ * @param  board: 板温(0.01°C)
+ * @param  rate: 当前采样率(Hz)
+ * @param  vdda: 实测VDDA(mV)
+ * @param  flags: 标志位 TELEMETRY_FLAG_xxx
+ * @retval 0 - 已写入发送队列, 1 - 发送队列已满
+ */
+uint8_t Telemetry_SendStatus(uint32_t timestamp, int32_t board, uint32_t rate, uint16_t vdda, uint8_t flags)
+{
+    uint8_t payload[11];
+    
+    Telemetry_Put32(payload, (uint32_t)board);
+    Telemetry_Put32(payload + 4, rate);
+    payload[8] = (uint8_t)vdda;
+    payload[9] = (uint8_t)(vdda >> 8);
+    payload[10] = flags;
+    
+    return Telemetry_Send(TELEMETRY_TYPE_STATUS, TELEMETRY_CHANNEL_SYS, timestamp, payload, sizeof(payload));
+}
+
+/**
+ * @brief  初始化批量帧缓存
+ * @param  batch: 批量帧缓存
+ * @param  channel: 通道号
+ * @retval 无
+ */
+void Telemetry_BatchInit(Telemetry_BatchTypeDef *batch, uint8_t channel)
+{
+    batch->channel = channel;
+    batch->count = 0;
+}
+
+/**
+ * @brief  加入一个采样
+ * @note   间隔与批内不符(采样率变化或丢输出)、标志变化、差分超出int8或首个采样滞留超过
+ *         TELEMETRY_BATCH_AGE_US时, 先发出已缓存的采样, 本采样开始新的一批; 满批立即发送
+ * @param  batch: 批量帧缓存
+ * @param  timestamp: 采样时刻(us)
+ * @param  value: 测量值(0.01单位)
+ * @param  flags: 标志位 TELEMETRY_FLAG_xxx
+ * @retval 0 - 无发送或已写入发送队列, 1 - 发送队列已满
+ */
+uint8_t Telemetry_BatchPush(Telemetry_BatchTypeDef *batch, uint32_t timestamp, int32_t value, uint8_t flags)
+{
+    uint32_t gap = timestamp - batch->last_time;
+    int32_t delta = value - batch->last;
+    uint8_t result = 0;
+    
+    if (batch->count > 0)
+    {
+        if (gap > 0 && flags == batch->flags && delta >= -128 && delta <= 127 &&
+            timestamp - batch->timestamp < TELEMETRY_BATCH_AGE_US &&
+            (batch->count == 1 || (gap + batch->interval / 4 >= batch->interval &&
+                                   gap <= batch->interval + batch->interval / 4)))
+        {
+            if (batch->count == 1)
+                batch->interval = gap;
+            batch->deltas[batch->count - 1] = (int8_t)delta;
+            batch->count++;
+            batch->last = value;
+            batch->last_time = timestamp;
+            
+            return (batch->count == TELEMETRY_BATCH_MAX) ? Telemetry_BatchFlush(batch) : 0;
+        }
+        
+        result = Telemetry_BatchFlush(batch);
+    }
+    
+    batch->timestamp = timestamp;
+    batch->last_time = timestamp;
+    batch->interval = 0;
+    batch->base = value;
+    batch->last = value;
+    batch->flags = flags;
+    batch->count = 1;
+    
+    return result;
+}
+
+/**
+ * @brief  发送已缓存的采样
+ * @param  batch: 批量帧缓存
+ * @retval 0 - 无缓存或已写入发送队列, 1 - 发送队列已满
+ */
+uint8_t Telemetry_BatchFlush(Telemetry_BatchTypeDef *batch)
+{
+    uint8_t payload[9 + TELEMETRY_BATCH_MAX - 1];
+    uint8_t length;
+    uint8_t i;
+    
+    if (batch->count == 0)
+        return 0;
+    
+    Telemetry_Put32(payload, (uint32_t)batch->base);
+    Telemetry_Put32(payload + 4, batch->interval);
+    payload[8] = batch->flags;
+    for (i = 0; i + 1 < batch->count; i++)
+    {
+        payload[9 + i] = (uint8_t)batch->deltas[i];
+    }
+    length = 9 + batch->count - 1;
+    batch->count = 0;
+    
+    return Telemetry_Send(TELEMETRY_TYPE_BATCH, batch->channel, batch->timestamp, payload, length);
+}
@@ -0,0 +1,72 @@
+/*
+ * 文件名: telemetry.h
+ * 描述: 遥测帧模块头文件
+ * 功能: 声明COBS分帧、硬件CRC32校验的二进制遥测帧及输出模式
+ */
+
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include "stm32f10x.h"
+
+/* 输出模式 */
+#define TELEMETRY_MODE_ASCII    0       // 文本行, 便于串口助手调试
+#define TELEMETRY_MODE_BINARY   1       // COBS分帧二进制, 前后各一个0x00
+
+/* 帧格式(COBS编码前, 多字节字段均为小端):
+ * 序号(u16) | 时间戳(u32, us) | 通道(u8) | 类型(u8) | 负载 | CRC32(u32)
+ * CRC32由片上CRC单元计算(多项式0x04C11DB7, 初值0xFFFFFFFF, 不反转, 无末尾异或),
+ * 覆盖帧头和负载, 不足4字节整数倍时补0按32位小端字输入.
+ * 编码后帧前后各加一个0x00: 命令回复等文本行夹在帧之间时自成一段(校验失败丢弃), 不会破坏下一帧 */
+#define TELEMETRY_HEADER_SIZE   8       // 帧头字节数
+#define TELEMETRY_PAYLOAD_MAX   40      // 单帧最大负载字节数
+#define TELEMETRY_FRAME_MAX     (TELEMETRY_HEADER_SIZE + TELEMETRY_PAYLOAD_MAX + 4)    // 编码前最大帧长
+#define TELEMETRY_ENCODED_MAX   (TELEMETRY_FRAME_MAX + TELEMETRY_FRAME_MAX / 254 + 3)  // 编码后最大长度(含前后0x00)
+
+/* 批量帧: 同一通道等间隔的连续采样合为一帧, 首个采样值完整发送, 其余为与前一个的int8差分.
+ * 满批(32个采样)编码后55字节, 每采样约1.7字节 */
+#define TELEMETRY_BATCH_MAX     32      // 每帧最多采样数
+#define TELEMETRY_BATCH_AGE_US  250000  // 批内首个采样最长滞留时间(us), 低输出率时限制延迟
+
+/* 帧类型 */
+#define TELEMETRY_TYPE_VALUE    0x01    // 测量值: int32(0.01单位) + u8标志
+#define TELEMETRY_TYPE_STATUS   0x02    // 状态: int32板温(0.01°C) + u32采样率(Hz) + u16 VDDA估计值(mV, 未校准) + u8标志
+#define TELEMETRY_TYPE_BATCH    0x03    // 批量测量值: int32首值(0.01单位) + u32采样间隔(us) + u8标志 + int8差分 x (采样数-1)
+#define TELEMETRY_TYPE_SPECTRUM 0x04    // 频谱信息: u8类型 + u8 log2n + u32采样率(Hz) + u32 FFT周期数 + u32幅度/峰值周期数 + u16个数
+#define TELEMETRY_TYPE_SPECTRUM_DATA 0x05   // 频谱数据: u16起始序号 + 若干u16幅度或(u16频点, u16幅度)
+
+/* 通道号: 0 ~ 19为帧内探头通道(0为主探头/融合结果), 以下为派生量 */
+#define TELEMETRY_CHANNEL_LEAD  0x40    // 滞后补偿后的温度估计
+#define TELEMETRY_CHANNEL_SYS   0xFF    // 系统状态
+
+/* 标志位 */
+#define TELEMETRY_FLAG_FAULT    0x01    // 探头故障, 数值无效
+#define TELEMETRY_FLAG_ALARM    0x02    // 超温报警
+#define TELEMETRY_FLAG_EARLY    0x04    // 提前报警
+
+/* 批量帧缓存, 时间戳为首个采样时刻 */
+typedef struct
+{
+    uint32_t timestamp;         // 首个采样时刻(us)
+    uint32_t last_time;         // 最近采样时刻(us)
+    uint32_t interval;          // 采样间隔(us), 由前两个采样确定
+    int32_t base;               // 首个采样值
+    int32_t last;               // 最近采样值
+    int8_t deltas[TELEMETRY_BATCH_MAX - 1]; // 逐个采样的差分
+    uint8_t count;              // 已缓存采样数
+    uint8_t channel;            // 通道号
+    uint8_t flags;              // 标志位, 批内相同
+} Telemetry_BatchTypeDef;
+
+/* 函数声明 */
+void Telemetry_Init(uint8_t mode);      // 初始化(使能CRC单元)并设置输出模式
+uint8_t Telemetry_SetMode(uint8_t mode);    // 设置输出模式
+uint8_t Telemetry_GetMode(void);        // 获取输出模式
+uint8_t Telemetry_Send(uint8_t type, uint8_t channel, uint32_t timestamp, const void *payload, uint8_t length); // 发送一帧
+uint8_t Telemetry_SendValue(uint8_t channel, uint32_t timestamp, int32_t value, uint8_t flags); // 发送测量值帧
+uint8_t Telemetry_SendStatus(uint32_t timestamp, int32_t board, uint32_t rate, uint16_t vdda, uint8_t flags); // 发送状态帧
+void Telemetry_BatchInit(Telemetry_BatchTypeDef *batch, uint8_t channel); // 初始化批量帧缓存
+uint8_t Telemetry_BatchPush(Telemetry_BatchTypeDef *batch, uint32_t timestamp, int32_t value, uint8_t flags); // 加入一个采样
+uint8_t Telemetry_BatchFlush(Telemetry_BatchTypeDef *batch); // 发送已缓存的采样
+
+#endif /* __TELEMETRY_H */
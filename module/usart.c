@@ -5,9 +5,93 @@
 
 #include "stm32f10x.h"
 #include "usart.h"
+#include "systick.h"
 #include <stdio.h>
 #include <string.h>
 
+/* 串口各中断(USART1、DMA1通道4/5/6)的抢占优先级(分组4, 见uesr_SystemInit):
+ * 低于ADC看门狗(0)和采样DMA/TIM3(1), 串口处理不推迟采样和报警 */
+#define USART_IRQ_PRIORITY      2
+
+/* 缓冲区容量须为2的幂, 环形下标用掩码回绕 */
+#define USART_TX_MASK   (USART_TX_BUF_SIZE - 1)
+
+/* 发送队列: 主循环和中断写入head, DMA从tail读出, 传输完成后tail才前移 */
+static uint8_t usart_tx_buffer[USART_TX_BUF_SIZE];  // 发送环形缓冲区
+static volatile uint16_t usart_tx_head = 0;         // 写入位置
+static volatile uint16_t usart_tx_tail = 0;         // DMA读出位置
+static volatile uint16_t usart_tx_busy = 0;         // 正在DMA发送的字节数, 0为空闲
+static volatile uint32_t usart_tx_overflow = 0;     // 因空间不足被整体丢弃的写入次数
+static volatile uint32_t usart_tx_dropped = 0;      // 被丢弃的字节数
+
+/* 接收缓冲区: DMA循环写入, 空闲/半满/全满中断时发布写入位置 */
+#define USART_RX_MASK   (USART_RX_BUF_SIZE - 1)
+
+static uint8_t usart_rx_buffer[USART_RX_BUF_SIZE];  // 接收环形缓冲区
+static volatile uint16_t usart_rx_head = 0;         // 已发布的写入位置
+static volatile uint16_t usart_rx_tail = 0;         // 读出位置
+static volatile uint16_t usart_rx_count = 0;        // 已接收未取走的字节数
+static volatile uint32_t usart_rx_time = 0;         // 最近一次发布新数据的时刻(ms)
+static volatile uint32_t usart_rx_overflow = 0;     // 未及时取走被覆盖的次数
+
+/* 空闲分帧边界: 以累计字节数记录每次线路空闲时的接收位置, 不受环形回绕影响 */
+#define USART_RX_FRAMES 8                               // 最多记录的未取完的帧数
+static volatile uint32_t usart_rx_total = 0;            // 累计接收(发布)的字节数
+static volatile uint32_t usart_rx_taken = 0;            // 累计取走的字节数
+static volatile uint32_t usart_rx_frames[USART_RX_FRAMES];  // 各帧结尾处的累计字节数
+static volatile uint8_t usart_rx_frame_first = 0;       // 最早一帧的位置
+static volatile uint8_t usart_rx_frame_count = 0;       // 已记录的帧数
+
+/* 自动波特率检测: TIM1_CH3输入捕获PA10(与USART1 RX同一引脚)的下降沿, 捕获值由DMA1通道6
+ * 搬运(2.25M波特时下降沿仅相隔64个CPU周期, 逐沿中断来不及). 同步字节0x55连同起始位
+ * 为交替的0/1, 相邻下降沿相隔2位, 第1到第5个下降沿相隔8位 */
+#define USART_AUTOBAUD_CLOCK    36000000    // TIM1计数频率(72MHz 2分频), 16位计数可测到4800波特
+#define USART_AUTOBAUD_EDGES    5           // 同步字节的下降沿数
+#define USART_AUTOBAUD_SETTLE_MS 2          // 检测后等同步字节收完再切换(9600波特一个字符约1ms)
+#define USART_AUTOBAUD_IDLE_MS  5           // 未凑齐的捕获在线路静止该时间后作废, 下一个下降沿作为起始位
+
+/* 自动检测结果须接近其中之一 */
+static const uint32_t usart_baud_table[] =
+{
+    4800, 9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1000000, 1500000, 2000000, 2250000
+};
+
+static volatile uint32_t usart_baud = USART_BAUD_DEFAULT;   // 当前波特率
+static volatile uint32_t usart_baud_pending = 0;    // 待生效的波特率, 0为没有待生效的切换
+static volatile uint16_t usart_baud_mark = 0;       // 切换请求时的写入位置, 此前的数据按原波特率发送
+static uint32_t usart_baud_fallback = 0;            // 协商切换前的波特率, 0为没有待确认的切换
+static uint32_t usart_baud_deadline = 0;            // 协商切换的确认截止时刻(ms)
+static uint16_t usart_autobaud_capture[USART_AUTOBAUD_EDGES];  // 下降沿捕获值
+static volatile uint8_t usart_autobaud_armed = 0;   // 正在检测
+static volatile uint32_t usart_autobaud_rate = 0;   // 中断中检测到的波特率, 0为尚未检测到
+static volatile uint32_t usart_autobaud_time = 0;   // 检测到的时刻(ms)
+static uint16_t usart_autobaud_remain = 0;          // 上次查看时DMA剩余的捕获数
+static uint32_t usart_autobaud_seen = 0;            // 上次捕获数变化的时刻(ms)
+
+static void USART_RxUpdate(void);
+
+/**
+ * @brief  启动下一段DMA发送
+ * @note   DMA不支持回绕, 每次发送tail到head或缓冲区末尾的连续一段; 有待生效的
+ *         波特率时只发送到切换请求时的写入位置, 其后的数据等切换后再发送.
+ *         调用时须屏蔽串口中断(BASEPRI)或在DMA1通道4中断中
+ * @param  无
+ * @retval 无
+ */
+static void USART_TxKick(void)
+{
+    uint16_t head = usart_baud_pending ? usart_baud_mark : usart_tx_head;
+    uint16_t tail = usart_tx_tail;
+    
+    if (usart_tx_busy || head == tail)
+        return;
+    
+    usart_tx_busy = (head > tail) ? head - tail : USART_TX_BUF_SIZE - tail;
+    DMA1_Channel4->CMAR = (uint32_t)&usart_tx_buffer[tail];
+    DMA1_Channel4->CNDTR = usart_tx_busy;
+    DMA_Cmd(DMA1_Channel4, ENABLE);
+}
+
 /**
  * @brief  配置USART模块
  * @param  无
@@ -18,9 +102,13 @@ void USART_Config(void)
     GPIO_InitTypeDef GPIO_InitStructure;
     USART_InitTypeDef USART_InitStructure;
     NVIC_InitTypeDef NVIC_InitStructure;
+    DMA_InitTypeDef DMA_InitStructure;
+    TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+    TIM_ICInitTypeDef TIM_ICInitStructure;
     
-    /* 使能USART1和GPIOA时钟 */
+    /* 使能USART1、GPIOA和DMA1时钟 */
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_USART1 | RCC_APB2Periph_GPIOA, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
     
     /* 配置USART1 Tx (PA9) 为复用推挽输出 */
     GPIO_InitStructure.GPIO_Pin = GPIO_Pin_9;
@@ -34,7 +122,7 @@ void USART_Config(void)
     GPIO_Init(GPIOA, &GPIO_InitStructure);
     
     /* 配置USART1参数 */
-    USART_InitStructure.USART_BaudRate = 9600;
+    USART_InitStructure.USART_BaudRate = USART_BAUD_DEFAULT;
     USART_InitStructure.USART_WordLength = USART_WordLength_8b;
     USART_InitStructure.USART_StopBits = USART_StopBits_1;
     USART_InitStructure.USART_Parity = USART_Parity_No;
@@ -42,77 +130,716 @@ void USART_Config(void)
     USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
     USART_Init(USART1, &USART_InitStructure);
     
-    /* 配置USART1中断 */
+    /* 配置USART1中断(线路空闲), 与串口DMA中断同级 */
     NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQn;
-    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART_IRQ_PRIORITY;
     NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);
     
-    /* 使能USART1接收中断 */
-    USART_ITConfig(USART1, USART_IT_RXNE, ENABLE);
+    /* DMA1通道5配置: USART1->DR到接收缓冲区, 循环模式, 半满/全满中断防止长数据覆盖 */
+    DMA_DeInit(DMA1_Channel5);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART1->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)usart_rx_buffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = USART_RX_BUF_SIZE;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel5, &DMA_InitStructure);
+    DMA_ITConfig(DMA1_Channel5, DMA_IT_HT | DMA_IT_TC, ENABLE);
+    DMA_Cmd(DMA1_Channel5, ENABLE);
+    
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel5_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART_IRQ_PRIORITY;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    USART_DMACmd(USART1, USART_DMAReq_Rx, ENABLE);
+    
+    /* 接收由DMA完成, 只在线路空闲(一条消息结束)时中断一次 */
+    USART_ITConfig(USART1, USART_IT_IDLE, ENABLE);
+    
+    /* DMA1通道4配置: 发送队列到USART1->DR, 单次模式, 地址和长度每段重新设置 */
+    DMA_DeInit(DMA1_Channel4);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&USART1->DR;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)usart_tx_buffer;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralDST;
+    DMA_InitStructure.DMA_BufferSize = 1;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel4, &DMA_InitStructure);
+    DMA_ITConfig(DMA1_Channel4, DMA_IT_TC, ENABLE);
+    
+    /* 发送完成中断与其余串口中断同级, 低于采集相关中断 */
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel4_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART_IRQ_PRIORITY;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+    USART_DMACmd(USART1, USART_DMAReq_Tx, ENABLE);
+    
+    /* TIM1配置: 通道3下降沿输入捕获, 计数器自由运行, 由USART_AutoBaudStart开启 */
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, ENABLE);
+    TIM_TimeBaseStructure.TIM_Period = 0xFFFF;
+    TIM_TimeBaseStructure.TIM_Prescaler = SystemCoreClock / USART_AUTOBAUD_CLOCK - 1;
+    TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+    TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+    TIM_TimeBaseStructure.TIM_RepetitionCounter = 0;
+    TIM_TimeBaseInit(TIM1, &TIM_TimeBaseStructure);
+    TIM_ICInitStructure.TIM_Channel = TIM_Channel_3;
+    TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Falling;
+    TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+    TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+    TIM_ICInitStructure.TIM_ICFilter = 0;   // 2.25M波特时一位仅32个计数, 不加滤波
+    TIM_ICInit(TIM1, &TIM_ICInitStructure);
+    TIM_DMACmd(TIM1, TIM_DMA_CC3, ENABLE);
+    
+    /* DMA1通道6配置: TIM1->CCR3到捕获数组, 单次模式, 每次检测重新装载 */
+    DMA_DeInit(DMA1_Channel6);
+    DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&TIM1->CCR3;
+    DMA_InitStructure.DMA_MemoryBaseAddr = (uint32_t)usart_autobaud_capture;
+    DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralSRC;
+    DMA_InitStructure.DMA_BufferSize = USART_AUTOBAUD_EDGES;
+    DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+    DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+    DMA_InitStructure.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel6, &DMA_InitStructure);
+    DMA_ITConfig(DMA1_Channel6, DMA_IT_TC, ENABLE);
+    
+    NVIC_InitStructure.NVIC_IRQChannel = DMA1_Channel6_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = USART_IRQ_PRIORITY;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
     
     /* 使能USART1 */
+    usart_baud = USART_BAUD_DEFAULT;
+    USART_Cmd(USART1, ENABLE);
+}
+
+/**
+ * @brief  写入发送队列
+ * @note   立即返回, 由DMA在后台发送. 空间不足时整段丢弃, 不截断消息, 并累计溢出次数
+ *         和丢弃字节数. 拷贝期间经BASEPRI只屏蔽串口优先级及以下的中断, ADC看门狗和
+ *         采样DMA中断照常响应; 因此只能在主循环或串口同级中断中调用
+ * @param  data: 待发送数据
+ * @param  length: 字节数
+ * @retval 0 - 已入队, 1 - 空间不足已丢弃
+ */
+uint8_t USART_Write(const void *data, uint16_t length)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    uint32_t basepri = __get_BASEPRI();
+    uint16_t head;
+    uint16_t first;
+    
+    __set_BASEPRI(USART_IRQ_PRIORITY << (8 - __NVIC_PRIO_BITS));
+    if (length > USART_GetTxFree())
+    {
+        usart_tx_overflow++;
+        usart_tx_dropped += length;
+        __set_BASEPRI(basepri);
+        return 1;
+    }
+    
+    /* 回绕处分两段拷贝 */
+    head = usart_tx_head;
+    first = USART_TX_BUF_SIZE - head;
+    if (first > length)
+        first = length;
+    memcpy(&usart_tx_buffer[head], bytes, first);
+    memcpy(usart_tx_buffer, bytes + first, length - first);
+    usart_tx_head = (head + length) & USART_TX_MASK;
+    USART_TxKick();
+    __set_BASEPRI(basepri);
+    
+    return 0;
+}
+
+/**
+ * @brief  获取发送队列剩余空间
+ * @note   正在DMA发送的字节在传输完成前仍占用空间; 分段输出大块数据前
+ *         应先检查剩余空间, 以免被整段丢弃
+ * @param  无
+ * @retval 剩余字节数
+ */
+uint16_t USART_GetTxFree(void)
+{
+    return USART_TX_MASK - ((usart_tx_head - usart_tx_tail) & USART_TX_MASK);
+}
+
+/**
+ * @brief  获取发送队列溢出统计
+ * @param  bytes: 输出被丢弃的字节数, 可传0
+ * @retval 因空间不足被丢弃的写入次数
+ */
+uint32_t USART_GetTxDropped(uint32_t *bytes)
+{
+    if (bytes)
+        *bytes = usart_tx_dropped;
+    
+    return usart_tx_overflow;
+}
+
+/**
+ * @brief  等待发送队列发完
+ * @note   忙等至队列为空且最后一个字节移出移位寄存器, 用于复位之前;
+ *         等待期间仍可能有中断写入, 因此设超时
+ * @param  timeout_ms: 最长等待时间(ms)
+ * @retval 0 - 已发完, 1 - 超时
+ */
+uint8_t USART_Flush(uint32_t timeout_ms)
+{
+    uint32_t start = GetSysTime_ms();
+    
+    while (usart_tx_busy || usart_tx_head != usart_tx_tail ||
+           USART_GetFlagStatus(USART1, USART_FLAG_TC) == RESET)
+    {
+        if (GetSysTime_ms() - start >= timeout_ms)
+            return 1;
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief  丢弃接收缓冲区中的全部数据
+ * @note   波特率切换前后收到的字节按错误的波特率采样, 不可信
+ * @param  无
+ * @retval 无
+ */
+static void USART_RxDiscard(void)
+{
+    __disable_irq();
+    USART_RxUpdate();
+    usart_rx_tail = usart_rx_head;
+    usart_rx_count = 0;
+    usart_rx_taken = usart_rx_total;
+    usart_rx_frame_count = 0;
+    __enable_irq();
+}
+
+/**
+ * @brief  设置波特率
+ * @note   不等待: 请求之前写入发送队列的数据仍按原波特率发送, 之后写入的数据
+ *         暂缓发送; 由USART_BaudPoll在原波特率的数据发完后改写BRR
+ * @param  baud: 波特率, USART_BAUD_MIN ~ USART_BAUD_MAX
+ * @retval 0 - 已请求, 1 - 参数无效
+ */
+uint8_t USART_SetBaudRate(uint32_t baud)
+{
+    uint32_t basepri = __get_BASEPRI();
+    
+    if (baud < USART_BAUD_MIN || baud > USART_BAUD_MAX)
+        return 1;
+    
+    __set_BASEPRI(USART_IRQ_PRIORITY << (8 - __NVIC_PRIO_BITS));
+    if (usart_baud_pending == 0)
+        usart_baud_mark = usart_tx_head;
+    usart_baud_pending = baud;
+    __set_BASEPRI(basepri);
+    
+    return 0;
+}
+
+/**
+ * @brief  使待生效的波特率生效
+ * @note   原波特率的数据须已全部移出移位寄存器. 改写BRR后丢弃已收到的数据, 并开始
+ *         发送暂缓的数据. USART1时钟为PCLK2(72MHz), BRR为PCLK2 / 波特率(含4位小数),
+ *         2.25M波特时为32, 误差不超过1/64
+ * @param  无
+ * @retval 0 - 已生效, 1 - 原波特率的数据尚未发完
+ */
+static uint8_t USART_BaudApply(void)
+{
+    RCC_ClocksTypeDef clocks;
+    uint32_t basepri = __get_BASEPRI();
+    uint32_t baud = usart_baud_pending;
+    
+    if (usart_tx_busy || usart_tx_tail != usart_baud_mark ||
+        USART_GetFlagStatus(USART1, USART_FLAG_TC) == RESET)
+        return 1;
+    
+    RCC_GetClocksFreq(&clocks);
+    USART_Cmd(USART1, DISABLE);
+    USART1->BRR = (uint16_t)((clocks.PCLK2_Frequency + baud / 2) / baud);
+    usart_baud = baud;
     USART_Cmd(USART1, ENABLE);
+    USART_RxDiscard();
+    
+    __set_BASEPRI(USART_IRQ_PRIORITY << (8 - __NVIC_PRIO_BITS));
+    usart_baud_pending = 0;
+    USART_TxKick();
+    __set_BASEPRI(basepri);
+    
+    return 0;
+}
+
+/**
+ * @brief  获取波特率
+ * @param  无
+ * @retval 波特率, 有待生效的切换时为切换后的波特率
+ */
+uint32_t USART_GetBaudRate(void)
+{
+    return usart_baud_pending ? usart_baud_pending : usart_baud;
+}
+
+/**
+ * @brief  重新装载下降沿捕获
+ * @note   丢弃已捕获的下降沿, 下一个下降沿作为同步字节的起始位
+ * @param  无
+ * @retval 无
+ */
+static void USART_AutoBaudRearm(void)
+{
+    DMA_Cmd(DMA1_Channel6, DISABLE);
+    TIM_GetCapture3(TIM1);      // 读CCR3清除捕获标志, 以免装载后立即搬运旧值
+    DMA1_Channel6->CNDTR = USART_AUTOBAUD_EDGES;
+    DMA_Cmd(DMA1_Channel6, ENABLE);
+    usart_autobaud_remain = USART_AUTOBAUD_EDGES;
+    usart_autobaud_seen = GetSysTime_ms();
+}
+
+/**
+ * @brief  开启自动波特率检测
+ * @note   等待对端发送同步字节USART_AUTOBAUD_SYNC, 检测到后由USART_BaudPoll切换;
+ *         只检测一次, 之后关闭, 以免正常数据误触发. 普通命令字节的下降沿间隔
+ *         不相等或不接近标准波特率, 不会被误认为同步字节
+ * @param  无
+ * @retval 无
+ */
+void USART_AutoBaudStart(void)
+{
+    usart_autobaud_rate = 0;
+    usart_autobaud_armed = 1;
+    USART_AutoBaudRearm();
+    TIM_Cmd(TIM1, ENABLE);
+}
+
+/**
+ * @brief  关闭自动波特率检测
+ * @note   已以当前波特率收到有效命令时由主循环调用, 链路已知可用, 同时作废尚未应用的检测结果
+ * @param  无
+ * @retval 无
+ */
+void USART_AutoBaudStop(void)
+{
+    usart_autobaud_rate = 0;
+    usart_autobaud_armed = 0;
+    DMA_Cmd(DMA1_Channel6, DISABLE);
+    TIM_Cmd(TIM1, DISABLE);
+}
+
+/**
+ * @brief  测得的波特率匹配到标准波特率
+ * @param  measured: 测得的波特率
+ * @retval 偏差3%以内的标准波特率, 0为无匹配
+ */
+static uint32_t USART_AutoBaudMatch(uint32_t measured)
+{
+    uint8_t i;
+    
+    for (i = 0; i < sizeof(usart_baud_table) / sizeof(usart_baud_table[0]); i++)
+    {
+        if ((measured > usart_baud_table[i] ? measured - usart_baud_table[i] : usart_baud_table[i] - measured) * 100
+            <= usart_baud_table[i] * 3)
+            return usart_baud_table[i];
+    }
+    
+    return 0;
+}
+
+/**
+ * @brief  协商切换波特率
+ * @note   原波特率下的回复发完后切换, 对端须在切换生效后USART_BAUD_CONFIRM_MS内
+ *         以新波特率确认, 否则USART_BaudPoll回退到切换前的波特率
+ * @param  baud: 新波特率
+ * @retval 0 - 已切换, 等待确认, 1 - 参数无效
+ */
+uint8_t USART_BaudSwitch(uint32_t baud)
+{
+    uint32_t previous = usart_baud;
+    
+    if (baud < USART_BAUD_MIN || baud > USART_BAUD_MAX)
+        return 1;
+    
+    /* 连续切换未确认时, 回退到最初可用的波特率 */
+    if (usart_baud_fallback == 0)
+        usart_baud_fallback = previous;
+    USART_SetBaudRate(baud);
+    
+    return 0;
+}
+
+/**
+ * @brief  确认协商切换的波特率
+ * @note   确认后链路已知可用, 同时关闭自动波特率检测
+ * @param  无
+ * @retval 0 - 已确认, 1 - 没有待确认的切换
+ */
+uint8_t USART_BaudConfirm(void)
+{
+    if (usart_baud_fallback == 0)
+        return 1;
+    
+    usart_baud_fallback = 0;
+    USART_AutoBaudStop();
+    
+    return 0;
+}
+
+/**
+ * @brief  波特率切换处理
+ * @note   在主循环中调用: 原波特率的数据发完后使待生效的波特率生效; 应用自动检测
+ *         的结果; 协商切换超时未确认时回退, 并重新开启自动波特率检测
+ * @param  无
+ * @retval 事件 USART_BAUD_EVENT_xxx, 新波特率由USART_GetBaudRate获取
+ */
+uint8_t USART_BaudPoll(void)
+{
+    uint32_t baud = usart_autobaud_rate;
+    uint16_t remain;
+    
+    /* 协商切换的确认时限从切换生效时算起 */
+    if (usart_baud_pending != 0 && USART_BaudApply() == 0 && usart_baud_fallback != 0)
+        usart_baud_deadline = GetSysTime_ms() + USART_BAUD_CONFIRM_MS;
+    
+    /* 未凑齐的捕获可能来自普通数据, 线路静止后作废, 使同步字节从起始位开始捕获 */
+    if (usart_autobaud_armed)
+    {
+        NVIC_DisableIRQ(DMA1_Channel6_IRQn);
+        remain = DMA_GetCurrDataCounter(DMA1_Channel6);
+        if (remain != usart_autobaud_remain)
+        {
+            usart_autobaud_remain = remain;
+            usart_autobaud_seen = GetSysTime_ms();
+        }
+        else if (remain != USART_AUTOBAUD_EDGES && GetSysTime_ms() - usart_autobaud_seen >= USART_AUTOBAUD_IDLE_MS)
+        {
+            USART_AutoBaudRearm();
+        }
+        NVIC_EnableIRQ(DMA1_Channel6_IRQn);
+    }
+    
+    if (baud != 0 && GetSysTime_ms() - usart_autobaud_time >= USART_AUTOBAUD_SETTLE_MS)
+    {
+        usart_autobaud_rate = 0;
+    
+        /* 与当前波特率相同: 多为普通命令参数中的0x55, 链路本就可用, 不切换也不丢弃接收数据 */
+        if (baud == USART_GetBaudRate())
+            return USART_BAUD_EVENT_NONE;
+    
+        usart_baud_fallback = 0;
+        USART_SetBaudRate(baud);
+        return USART_BAUD_EVENT_DETECTED;
+    }
+    
+    if (usart_baud_fallback != 0 && usart_baud_pending == 0 &&
+        (int32_t)(GetSysTime_ms() - usart_baud_deadline) >= 0)
+    {
+        baud = usart_baud_fallback;
+        usart_baud_fallback = 0;
+        USART_SetBaudRate(baud);
+        USART_AutoBaudStart();
+        return USART_BAUD_EVENT_FALLBACK;
+    }
+    
+    return USART_BAUD_EVENT_NONE;
 }
 
 /**
  * @brief  发送一个字节数据
+ * @note   写入发送队列, 不等待发送完成; 目前仅USART1使用发送队列
  * @param  USARTx: 指定的USART端口
  * @param  data: 要发送的数据
  * @retval 无
  */
 void USART_SendByte(USART_TypeDef* USARTx, uint8_t data)
 {
-    /* 等待发送缓冲区为空 */
-    while(USART_GetFlagStatus(USARTx, USART_FLAG_TXE) == RESET);
-    
-    /* 发送数据 */
-    USART_SendData(USARTx, data);
-    
-    /* 等待发送完成 */
-    while(USART_GetFlagStatus(USARTx, USART_FLAG_TC) == RESET);
+    USART_Write(&data, 1);
 }
 
 /**
  * @brief  发送字符串
+ * @note   整个字符串一次写入发送队列, 不等待发送完成
  * @param  USARTx: 指定的USART端口
  * @param  str: 要发送的字符串
  * @retval 无
  */
 void USART_SendString(USART_TypeDef* USARTx, char* str)
 {
-    uint16_t i = 0;
-    
-    /* 循环发送每个字符 */
-    while(str[i] != '\0')
-    {
-        USART_SendByte(USARTx, str[i++]);
-    }
+    USART_Write(str, (uint16_t)strlen(str));
 }
 
 /**
  * @brief  接收一个字节数据
+ * @note   阻塞等待接收缓冲区非空, 取走一个字节; 目前仅USART1使用接收缓冲区
  * @param  USARTx: 指定的USART端口
  * @retval 接收到的数据
  */
 uint8_t USART_ReceiveByte(USART_TypeDef* USARTx)
 {
+    uint8_t data;
+    
     /* 等待接收缓冲区非空 */
-    while(USART_GetFlagStatus(USARTx, USART_FLAG_RXNE) == RESET);
+    while (USART_RxAvailable() == 0);
     
     /* 返回接收到的数据 */
-    return (uint8_t)USART_ReceiveData(USARTx);
+    data = USART_RxAt(0);
+    USART_RxConsume(1);
+    return data;
+}
+
+/**
+ * @brief  发布DMA已写入的接收数据
+ * @note   在线路空闲和DMA半满/全满中断中调用, 两次调用间隔不超过半个缓冲区,
+ *         新增字节数不会超过缓冲区容量; 未取走的数据被覆盖时整体丢弃
+ * @param  无
+ * @retval 无
+ */
+static void USART_RxUpdate(void)
+{
+    uint16_t head = (USART_RX_BUF_SIZE - DMA_GetCurrDataCounter(DMA1_Channel5)) & USART_RX_MASK;
+    uint16_t count = usart_rx_count + ((head - usart_rx_head) & USART_RX_MASK);
+    
+    if (head == usart_rx_head)
+        return;
+    
+    usart_rx_total += (head - usart_rx_head) & USART_RX_MASK;
+    if (count > USART_RX_MASK)
+    {
+        usart_rx_overflow++;
+        usart_rx_tail = head;
+        usart_rx_taken = usart_rx_total;
+        usart_rx_frame_count = 0;
+        count = 0;
+    }
+    usart_rx_head = head;
+    usart_rx_count = count;
+    usart_rx_time = GetSysTime_ms();
+}
+
+/**
+ * @brief  获取已接收未取走的字节数
+ * @param  无
+ * @retval 字节数
+ */
+uint16_t USART_RxAvailable(void)
+{
+    return usart_rx_count;
+}
+
+/**
+ * @brief  查看接收缓冲区中连续的一段
+ * @note   不拷贝, data直接指向接收缓冲区; 数据跨越缓冲区末尾时只返回末尾之前的部分,
+ *         取走后再次调用得到其余部分. 取走之前数据不会被覆盖(除非缓冲区溢出)
+ * @param  data: 输出数据起始地址
+ * @retval 连续可读字节数, 0为无数据
+ */
+uint16_t USART_RxPeek(const uint8_t **data)
+{
+    uint16_t tail = usart_rx_tail;
+    uint16_t count = usart_rx_count;
+    
+    *data = &usart_rx_buffer[tail];
+    if (count > USART_RX_BUF_SIZE - tail)
+        count = USART_RX_BUF_SIZE - tail;
+    
+    return count;
+}
+
+/**
+ * @brief  查看第offset个未取走的字节
+ * @note   用于解析跨越缓冲区末尾的消息, 调用前须确认offset < USART_RxAvailable()
+ * @param  offset: 相对读出位置的偏移
+ * @retval 字节值
+ */
+uint8_t USART_RxAt(uint16_t offset)
+{
+    return usart_rx_buffer[(usart_rx_tail + offset) & USART_RX_MASK];
+}
+
+/**
+ * @brief  取走接收数据
+ * @param  length: 字节数, 超过可读字节数时全部取走
+ * @retval 无
+ */
+void USART_RxConsume(uint16_t length)
+{
+    __disable_irq();
+    if (length > usart_rx_count)
+        length = usart_rx_count;
+    usart_rx_tail = (usart_rx_tail + length) & USART_RX_MASK;
+    usart_rx_count -= length;
+    usart_rx_taken += length;
+    
+    /* 已整帧取走的边界作废 */
+    while (usart_rx_frame_count && (int32_t)(usart_rx_frames[usart_rx_frame_first] - usart_rx_taken) <= 0)
+    {
+        usart_rx_frame_first = (usart_rx_frame_first + 1) % USART_RX_FRAMES;
+        usart_rx_frame_count--;
+    }
+    __enable_irq();
+}
+
+/**
+ * @brief  获取当前帧剩余的字节数
+ * @note   帧以线路空闲分隔(对端一次连续发送的数据), 用于命令解析出错时丢弃整帧重新同步
+ * @param  无
+ * @retval 从读出位置到当前帧结尾的字节数, 0为当前帧尚未结束(线路未空闲)
+ */
+uint16_t USART_RxFrameRemain(void)
+{
+    uint16_t remain = 0;
+    
+    __disable_irq();
+    if (usart_rx_frame_count)
+        remain = (uint16_t)(usart_rx_frames[usart_rx_frame_first] - usart_rx_taken);
+    __enable_irq();
+    
+    return remain;
+}
+
+/**
+ * @brief  获取最近一次收到数据的时刻
+ * @note   以空闲/半满/全满中断发布数据的时刻计, 用于判断不完整消息是否超时
+ * @param  无
+ * @retval 时刻(ms, GetSysTime_ms时基)
+ */
+uint32_t USART_GetRxTime(void)
+{
+    return usart_rx_time;
+}
+
+/**
+ * @brief  获取接收缓冲区溢出次数
+ * @param  无
+ * @retval 未及时取走而被整体丢弃的次数
+ */
+uint32_t USART_GetRxOverflow(void)
+{
+    return usart_rx_overflow;
 }
 
 /* 重定向printf函数 */
 int fputc(int ch, FILE *f)
 {
-    /* 发送一个字节数据到USART1 */
-    USART_SendData(USART1, (uint8_t)ch);
-    
-    /* 等待发送完毕 */
-    while(USART_GetFlagStatus(USART1, USART_FLAG_TXE) == RESET);
+    /* 写入USART1发送队列 */
+    USART_SendByte(USART1, (uint8_t)ch);
     
     return ch;
 }
+
+/**
+ * @brief  USART1中断处理函数
+ * @note   线路空闲表示一条消息接收完毕, 先读SR再读DR清除IDLE标志, 并记录帧边界
+ * @param  无
+ * @retval 无
+ */
+void USART1_IRQHandler(void)
+{
+    if (USART_GetITStatus(USART1, USART_IT_IDLE) != RESET)
+    {
+        USART_ReceiveData(USART1);
+        USART_RxUpdate();
+    
+        /* 记录帧边界; 记录已满时并入最后一帧 */
+        if (usart_rx_total != usart_rx_taken &&
+            (usart_rx_frame_count == 0 ||
+             usart_rx_frames[(usart_rx_frame_first + usart_rx_frame_count - 1) % USART_RX_FRAMES] != usart_rx_total))
+        {
+            if (usart_rx_frame_count < USART_RX_FRAMES)
+                usart_rx_frame_count++;
+            usart_rx_frames[(usart_rx_frame_first + usart_rx_frame_count - 1) % USART_RX_FRAMES] = usart_rx_total;
+        }
+    }
+}
+
+/**
+ * @brief  DMA1通道5中断处理函数
+ * @note   长消息每半个缓冲区发布一次, 主循环可及时取走
+ * @param  无
+ * @retval 无
+ */
+void DMA1_Channel5_IRQHandler(void)
+{
+    if (DMA_GetITStatus(DMA1_IT_HT5) != RESET)
+        DMA_ClearITPendingBit(DMA1_IT_HT5);
+    if (DMA_GetITStatus(DMA1_IT_TC5) != RESET)
+        DMA_ClearITPendingBit(DMA1_IT_TC5);
+    
+    USART_RxUpdate();
+}
+
+/**
+ * @brief  DMA1通道4中断处理函数
+ * @note   一段发送完成后释放其空间, 继续发送队列中的下一段
+ * @param  无
+ * @retval 无
+ */
+void DMA1_Channel4_IRQHandler(void)
+{
+    if (DMA_GetITStatus(DMA1_IT_TC4) != RESET)
+    {
+        DMA_ClearITPendingBit(DMA1_IT_TC4);
+        DMA_Cmd(DMA1_Channel4, DISABLE);
+        usart_tx_tail = (usart_tx_tail + usart_tx_busy) & USART_TX_MASK;
+        usart_tx_busy = 0;
+        USART_TxKick();
+    }
+}
+
+/**
+ * @brief  DMA1通道6中断处理函数
+ * @note   凑齐同步字节的5个下降沿后检查: 4个间隔与第一个相差均不超过1/8, 且首末
+ *         间隔(8位)换算的波特率匹配标准波特率, 才算检测到; 否则重新捕获
+ * @param  无
+ * @retval 无
+ */
+void DMA1_Channel6_IRQHandler(void)
+{
+    uint16_t interval, first, diff, span;
+    uint32_t baud = 0;
+    uint8_t i;
+    
+    if (DMA_GetITStatus(DMA1_IT_TC6) == RESET)
+        return;
+    DMA_ClearITPendingBit(DMA1_IT_TC6);
+    
+    first = usart_autobaud_capture[1] - usart_autobaud_capture[0];
+    for (i = 2; i < USART_AUTOBAUD_EDGES; i++)
+    {
+        interval = usart_autobaud_capture[i] - usart_autobaud_capture[i - 1];
+        diff = (interval > first) ? interval - first : first - interval;
+        if (diff > first / 8)
+            break;
+    }
+    
+    span = usart_autobaud_capture[USART_AUTOBAUD_EDGES - 1] - usart_autobaud_capture[0];
+    if (i == USART_AUTOBAUD_EDGES && span != 0)
+        baud = USART_AutoBaudMatch((uint32_t)USART_AUTOBAUD_CLOCK * 8 / span);
+    if (baud == 0)
+    {
+        USART_AutoBaudRearm();
+        return;
+    }
+    
+    USART_AutoBaudStop();
+    usart_autobaud_rate = baud;
+    usart_autobaud_time = GetSysTime_ms();
+}
@@ -9,8 +9,44 @@
 
 #include "stm32f10x.h"
 
+/* 波特率 (USART1挂在APB2, 72MHz): 上电为默认值, 可自动检测或协商切换 */
+#define USART_BAUD_DEFAULT      9600    // 上电默认波特率, 兼容原有上位机
+#define USART_BAUD_MIN          4800    // 最低波特率(自动检测计时器的下限)
+#define USART_BAUD_MAX          2250000 // 最高波特率
+#define USART_BAUD_CONFIRM_MS   1000    // 协商切换后等待确认的时间(ms), 超时回退
+#define USART_AUTOBAUD_SYNC     0x55    // 自动波特率检测的同步字节
+
+/* USART_BaudPoll返回的事件 */
+#define USART_BAUD_EVENT_NONE       0   // 无变化
+#define USART_BAUD_EVENT_DETECTED   1   // 自动检测到波特率并已切换
+#define USART_BAUD_EVENT_FALLBACK   2   // 协商切换未确认, 已回退
+
+/* 发送队列参数 (USART1 TX由DMA1通道4发送) */
+#define USART_TX_BUF_SIZE       1024    // 发送环形缓冲区容量(2的幂)
+
+/* 接收缓冲区参数 (USART1 RX由DMA1通道5循环写入, 线路空闲中断分帧) */
+#define USART_RX_BUF_SIZE       256     // 接收环形缓冲区容量(2的幂)
+
 /* 函数声明 */
 void USART_Config(void);                                // 配置USART
+uint8_t USART_Write(const void *data, uint16_t length); // 写入发送队列(非阻塞)
+uint16_t USART_GetTxFree(void);                         // 获取发送队列剩余空间(字节)
+uint32_t USART_GetTxDropped(uint32_t *bytes);           // 获取发送队列溢出次数及丢弃字节数
+uint8_t USART_Flush(uint32_t timeout_ms);               // 等待发送队列发完(有超时)
+uint16_t USART_RxAvailable(void);                       // 获取已接收未取走的字节数
+uint16_t USART_RxPeek(const uint8_t **data);            // 查看接收缓冲区中连续的一段(不拷贝)
+uint8_t USART_RxAt(uint16_t offset);                    // 查看第offset个未取走的字节
+void USART_RxConsume(uint16_t length);                  // 取走length个字节
+uint16_t USART_RxFrameRemain(void);                     // 获取当前帧(以线路空闲分隔)剩余的字节数
+uint32_t USART_GetRxTime(void);                         // 获取最近一次收到数据的时刻(ms)
+uint32_t USART_GetRxOverflow(void);                     // 获取接收缓冲区溢出次数
+uint8_t USART_SetBaudRate(uint32_t baud);               // 请求切换波特率(已排队数据发完后生效)
+uint32_t USART_GetBaudRate(void);                       // 获取当前波特率
+void USART_AutoBaudStart(void);                         // 开启自动波特率检测(一次)
+void USART_AutoBaudStop(void);                          // 关闭自动波特率检测
+uint8_t USART_BaudSwitch(uint32_t baud);                // 协商切换波特率, 等待确认
+uint8_t USART_BaudConfirm(void);                        // 确认协商切换的波特率
+uint8_t USART_BaudPoll(void);                           // 波特率切换处理(主循环调用)
 void USART_SendByte(USART_TypeDef* USARTx, uint8_t data); // 发送一个字节数据
 void USART_SendString(USART_TypeDef* USARTx, char* str);  // 发送字符串
 uint8_t USART_ReceiveByte(USART_TypeDef* USARTx);        // 接收一个字节数据